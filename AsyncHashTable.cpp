@@ -0,0 +1,126 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the cpp file for the AsyncHashTable class. It contains the constructor, the destructor and
+* all the function definitions. This file includes: The AsyncHashTable constructor and destructor,
+* the async_get function, the run function, the pendingCount function, the runGroup function, the
+* LookupAwaiter await_suspend function.
+* -----------------------------------------------------------------------------------------*/
+
+#include "AsyncHashTable.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+* The constructor wraps a table and takes how many lookups to prefetch together, 16 if none is
+* given. The table has to outlive the AsyncHashTable.
+*/
+
+AsyncHashTable::AsyncHashTable(HashTable& table, size_t group)
+    : table(table), groupSize(std::max<size_t>(group, 1)), groups(0), lookups(0) {}
+
+/**
+* The destructor destroys any coroutines still parked, since nothing would ever resume them. Their
+* locals are destroyed as if they had returned early, so run() should be called first if they
+* need to finish.
+*/
+
+AsyncHashTable::~AsyncHashTable() {
+    // Take the list first, destroying a frame also destroys the awaiter pending points at
+    vector<LookupAwaiter*> parked;
+    parked.swap(pending);
+    for (LookupAwaiter* lookup : parked) {
+        lookup->waiting.destroy();
+    }
+}
+
+/**
+* async_get returns something to co_await for the key's value. Nothing is looked up until run()
+* gets to it, and the coroutine gets nullopt back if the key isn't in the table.
+*/
+
+LookupAwaiter AsyncHashTable::async_get(std::string key) {
+    LookupAwaiter awaiter;
+    awaiter.owner = this;
+    awaiter.key = std::move(key);
+    return awaiter;
+}
+
+/**
+* await_suspend parks the coroutine in its table's pending list until run() resumes it.
+*/
+
+void LookupAwaiter::await_suspend(coroutine_handle<> handle) {
+    waiting = handle;
+    owner->pending.push_back(this);
+}
+
+/**
+* run resumes parked coroutines until none are left, groupSize lookups at a time. A coroutine that
+* awaits again while being resumed is parked for a later group, so requests from many coroutines
+* keep getting interleaved. Returns how many lookups were done.
+*/
+
+size_t AsyncHashTable::run() {
+    size_t done = 0;
+    while (!pending.empty()) {
+        // Take everything parked so far, resuming can park more
+        vector<LookupAwaiter*> batch;
+        batch.swap(pending);
+        for (size_t first = 0; first < batch.size(); first += groupSize) {
+            size_t count = std::min(groupSize, batch.size() - first);
+            runGroup(batch.data() + first, count);
+            done += count;
+        }
+    }
+    return done;
+}
+
+/**
+* runGroup does one group of lookups in three passes: hash every key and prefetch its home bucket,
+* then prefetch the key bytes of the home buckets that are full (by now their bucket has had time
+* to arrive), then probe and resume each coroutine in turn. Most lookups end at the home bucket,
+* so the probe pass mostly hits cache lines that are already loaded.
+*/
+
+void AsyncHashTable::runGroup(LookupAwaiter** group, size_t count) {
+    // Pass 1, hash and start loading every home bucket
+    for (size_t i = 0; i < count; i++) {
+        LookupAwaiter& lookup = *group[i];
+        lookup.hash = table.hasher(lookup.key);
+        lookup.home = lookup.hash % table.capacity();
+        __builtin_prefetch(&table.table[lookup.home]);
+    }
+    // Pass 2, start loading the stored key bytes for the buckets that hold a key
+    for (size_t i = 0; i < count; i++) {
+        const HashTableBucket& bucket = table.table[group[i]->home];
+        if (bucket.type == bucketType::NORMAL) {
+            __builtin_prefetch(bucket.bucketKey.data());
+        }
+    }
+    // Pass 3, finish each lookup from the hash pass 1 worked out and resume its coroutine
+    for (size_t i = 0; i < count; i++) {
+        LookupAwaiter& lookup = *group[i];
+        size_t hole = table.locateLive(lookup.key, lookup.hash);
+        lookup.result = nullopt;
+        if (hole != table.capacity()) {
+            lookup.result = table.table[hole].bucketValue;
+        }
+        lookups++;
+        // The coroutine may park again, which lands in pending for the next round
+        lookup.waiting.resume();
+    }
+    groups++;
+}
+
+/**
+* pendingCount returns how many coroutines are parked waiting for run().
+*/
+
+size_t AsyncHashTable::pendingCount() const {
+    return pending.size();
+}
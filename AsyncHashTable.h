@@ -0,0 +1,85 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the header file for the AsyncHashTable class. It's a coroutine front-end for a
+* HashTable: a coroutine writes co_await ht.async_get(key), which parks it instead of probing
+* right away, and run() later takes the parked lookups in groups, prefetches every group's home
+* buckets (and then their key bytes) before probing any of them, and resumes the coroutines one
+* after another. The memory loads for a whole group overlap instead of each lookup waiting on its
+* own cache misses. This file includes: The AsyncHashTable constructor and destructor, the async_get
+* function, the run function, the pendingCount function, the runGroup function, the LookupAwaiter
+* class, the LookupTask class.
+* -----------------------------------------------------------------------------------------*/
+#pragma once
+
+#include "HashTable.h"
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Default number of lookups prefetched together
+constexpr size_t ASYNC_GROUP_SIZE = 16;
+
+class AsyncHashTable;
+
+/**
+* What co_await ht.async_get(key) waits on. It always suspends, and gets the lookup's result
+* filled in by AsyncHashTable::run before the coroutine is resumed.
+*/
+
+class LookupAwaiter {
+    public:
+        // LookupAwaiter variables
+        AsyncHashTable* owner;
+        std::string key;
+        size_t hash = 0;
+        size_t home = 0;
+        optional<size_t> result;
+        coroutine_handle<> waiting;
+        // LookupAwaiter function declarations
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(coroutine_handle<> handle);
+        optional<size_t> await_resume() noexcept { return result; }
+};
+
+/**
+* A fire-and-forget coroutine type for request handlers. It starts running right away, runs up to
+* its first co_await, and frees itself when it finishes. An exception that escapes it ends the
+* program, the same as one escaping a detached thread.
+*/
+
+class LookupTask {
+    public:
+        struct promise_type {
+            LookupTask get_return_object() noexcept { return {}; }
+            suspend_never initial_suspend() noexcept { return {}; }
+            suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { terminate(); }
+        };
+};
+
+class AsyncHashTable {
+    public:
+        // AsyncHashTable variables
+        HashTable& table;
+        vector <LookupAwaiter*> pending;
+        size_t groupSize;
+        size_t groups;
+        size_t lookups;
+        // AsyncHashTable constructor declaration
+        explicit AsyncHashTable(HashTable& table, size_t group = ASYNC_GROUP_SIZE);
+        ~AsyncHashTable();
+        AsyncHashTable(const AsyncHashTable&) = delete;
+        AsyncHashTable& operator=(const AsyncHashTable&) = delete;
+        // AsyncHashTable function declarations
+        LookupAwaiter async_get(std::string key);
+        size_t run();
+        size_t pendingCount() const;
+        void runGroup(LookupAwaiter** group, size_t count);
+};
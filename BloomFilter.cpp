@@ -0,0 +1,103 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the cpp file for the BloomFilter class. It contains the constructor and all the
+* function definitions. This file includes: The BloomFilter constructor, the reset function, the
+* add function, the mayContain function, the enabled function, the clear function, the bitCount
+* function.
+* -----------------------------------------------------------------------------------------*/
+
+#include "BloomFilter.h"
+#include <algorithm>
+
+using namespace std;
+
+/**
+* The default constructor makes a disabled filter with no bits. A disabled filter says every key
+* might be there.
+*/
+
+BloomFilter::BloomFilter() {
+    hashCount = 0;
+}
+
+/**
+* reset throws away every bit and sizes the filter for expectedKeys keys at bitsPerKey bits each.
+* The number of bits set per key is picked to give the lowest false positive rate for that size,
+* about 1% at 10 bits per key.
+*/
+
+void BloomFilter::reset(size_t expectedKeys, size_t bitsPerKey) {
+    // Round the bits up to whole blocks
+    size_t bits = std::max<size_t>(expectedKeys, 1) * std::max<size_t>(bitsPerKey, 1);
+    size_t blockCount = (bits + 511) / 512;
+    blocks.assign(blockCount, BloomBlock{});
+    // bitsPerKey * ln 2 hashes, kept between 1 and 16
+    hashCount = std::clamp<size_t>(bitsPerKey * 69 / 100, 1, 16);
+}
+
+/**
+* add sets the key's bits. Only the key's hash is needed, the key itself is never looked at.
+*/
+
+void BloomFilter::add(uint64_t hash) {
+    // The low half of the hash picks the block, the high half picks bits inside it
+    BloomBlock& block = blocks[(hash & 0xFFFFFFFFu) % blocks.size()];
+    auto step = static_cast<uint32_t>(hash >> 32);
+    uint32_t delta = (step >> 17) | (step << 15) | 1u;
+    for (size_t i = 0; i < hashCount; i++) {
+        uint32_t bit = step & 511u;
+        block.words[bit >> 6] |= 1ULL << (bit & 63);
+        step += delta;
+    }
+}
+
+/**
+* mayContain returns false only if the key was definitely never added. True means it might have
+* been, and the table has to check.
+*/
+
+bool BloomFilter::mayContain(uint64_t hash) const {
+    // A disabled filter can't rule anything out
+    if (blocks.empty()) {
+        return true;
+    }
+    const BloomBlock& block = blocks[(hash & 0xFFFFFFFFu) % blocks.size()];
+    auto step = static_cast<uint32_t>(hash >> 32);
+    uint32_t delta = (step >> 17) | (step << 15) | 1u;
+    for (size_t i = 0; i < hashCount; i++) {
+        uint32_t bit = step & 511u;
+        if ((block.words[bit >> 6] & (1ULL << (bit & 63))) == 0) {
+            return false;
+        }
+        step += delta;
+    }
+    return true;
+}
+
+/**
+* enabled returns whether the filter has any bits to check.
+*/
+
+bool BloomFilter::enabled() const {
+    return !blocks.empty();
+}
+
+/**
+* clear turns the filter off and frees its bits.
+*/
+
+void BloomFilter::clear() {
+    blocks.clear();
+    blocks.shrink_to_fit();
+    hashCount = 0;
+}
+
+/**
+* bitCount returns how many bits the filter has.
+*/
+
+size_t BloomFilter::bitCount() const {
+    return blocks.size() * 512;
+}
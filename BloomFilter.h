@@ -0,0 +1,38 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the header file for the BloomFilter class. HashTable keeps one in front of its buckets
+* so a key that was never inserted can usually be turned away without probing at all. The filter
+* is blocked: all of a key's bits are in the same 64 byte block, so a check is one cache miss.
+* This file includes: The BloomFilter constructor, the reset function, the add function, the
+* mayContain function, the enabled function, the clear function, the bitCount function.
+* -----------------------------------------------------------------------------------------*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// One cache line worth of filter bits
+struct alignas(64) BloomBlock {
+    uint64_t words[8];
+};
+
+class BloomFilter {
+    public:
+        // BloomFilter variables
+        vector <BloomBlock> blocks;
+        size_t hashCount;
+        // BloomFilter constructor declaration
+        BloomFilter();
+        // BloomFilter function declarations
+        void reset(size_t expectedKeys, size_t bitsPerKey);
+        void add(uint64_t hash);
+        bool mayContain(uint64_t hash) const;
+        bool enabled() const;
+        void clear();
+        size_t bitCount() const;
+};
@@ -0,0 +1,327 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the cpp file for the CompactHashTable class. It contains the constructors and all the
+* function definitions. This file includes: The CompactHashTable constructors, the insert
+* function, the remove function, the contains function, the get function, the keys function, the
+* capacity function, the size function, the alpha function, the memory_usage function, the locate
+* function, the keyMatches function, the keyAt function, the arenaKey function, the inlineRef
+* function, the makeRef function, the rebuild function.
+* -----------------------------------------------------------------------------------------*/
+
+#include "CompactHashTable.h"
+#include "HashTable.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+* The constructor makes an empty table with at least cap slots, rounded up to a power of two.
+*/
+
+CompactHashTable::CompactHashTable(size_t cap) {
+    filled = 0;
+    removed = 0;
+    deadBytes = 0;
+    slots.assign(bit_ceil(std::max<size_t>(cap, 8)), CompactSlot{COMPACT_EMPTY, 0});
+}
+
+/**
+* This constructor copies every pair out of a HashTable. Throws an exception if a value doesn't
+* fit in 32 bits.
+*/
+
+CompactHashTable::CompactHashTable(const HashTable& source) : CompactHashTable(source.size() * 4 / 3 + 1) {
+    for (const auto& [key, value] : source) {
+        if (value > UINT32_MAX) {
+            throw exception();
+        }
+        insert(key, static_cast<uint32_t>(value));
+    }
+}
+
+/**
+* inlineRef packs a key of 3 bytes or less into a reference: the tag, the length in bits 2-3 and
+* the bytes in the top 3 bytes. Two short keys are equal exactly when their references are.
+*/
+
+uint32_t CompactHashTable::inlineRef(const std::string& key) {
+    uint32_t ref = COMPACT_INLINE | static_cast<uint32_t>(key.size()) << 2;
+    for (size_t i = 0; i < key.size(); i++) {
+        ref |= static_cast<uint32_t>(static_cast<unsigned char>(key[i])) << (8 * (i + 1));
+    }
+    return ref;
+}
+
+/**
+* makeRef returns the tagged reference for a key. A short key is packed into the reference,
+* anything longer is appended to into behind a 1 or 5 byte length. Throws an exception if the
+* arena would grow past what 30 bits can point at.
+*/
+
+uint32_t CompactHashTable::makeRef(const std::string& key, std::string& into) {
+    if (key.size() <= COMPACT_INLINE_MAX) {
+        return inlineRef(key);
+    }
+    // Long keys: lengths under 255 take one byte, anything else 0xFF and 4 more
+    size_t offset = into.size();
+    size_t need = key.size() + (key.size() < 0xFF ? 1 : 5);
+    if (offset + need > COMPACT_ARENA_MAX || key.size() > UINT32_MAX) {
+        throw exception();
+    }
+    if (key.size() < 0xFF) {
+        into.push_back(static_cast<char>(key.size()));
+    } else {
+        uint32_t length = static_cast<uint32_t>(key.size());
+        into.push_back(static_cast<char>(0xFF));
+        into.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    }
+    into += key;
+    return COMPACT_ARENA | static_cast<uint32_t>(offset) << 2;
+}
+
+/**
+* arenaKey returns the key an arena reference points at in from, without copying it.
+*/
+
+string_view CompactHashTable::arenaKey(const std::string& from, uint32_t ref) {
+    // Arena keys start with their length
+    size_t offset = ref >> 2;
+    size_t length = static_cast<unsigned char>(from[offset]);
+    offset++;
+    if (length == 0xFF) {
+        uint32_t longLength;
+        memcpy(&longLength, from.data() + offset, sizeof(longLength));
+        length = longLength;
+        offset += sizeof(longLength);
+    }
+    return string_view(from).substr(offset, length);
+}
+
+/**
+* keyAt returns a copy of the key a full slot's reference is for.
+*/
+
+std::string CompactHashTable::keyAt(uint32_t ref) const {
+    // Inline keys are unpacked straight out of the reference
+    if ((ref & 3) == COMPACT_INLINE) {
+        std::string key((ref >> 2) & 3, '\0');
+        for (size_t i = 0; i < key.size(); i++) {
+            key[i] = static_cast<char>(ref >> (8 * (i + 1)));
+        }
+        return key;
+    }
+    return std::string(arenaKey(arena, ref));
+}
+
+/**
+* keyMatches returns true if a full slot's reference is for this key. Short keys are compared as
+* whole references, so they never touch the arena.
+*/
+
+bool CompactHashTable::keyMatches(uint32_t ref, const std::string& key) const {
+    if (key.size() <= COMPACT_INLINE_MAX) {
+        return ref == inlineRef(key);
+    }
+    return (ref & 3) == COMPACT_ARENA && arenaKey(arena, ref) == key;
+}
+
+/**
+* locate walks the key's probe sequence and returns the slot holding it, or capacity() if it isn't
+* there. If firstFree is given, it's set to the first empty or removed slot along the way, which is
+* where an insert should go.
+*/
+
+size_t CompactHashTable::locate(const std::string& key, size_t* firstFree) const {
+    size_t mask = slots.size() - 1;
+    size_t pos = hasher(key) & mask;
+    if (firstFree != nullptr) {
+        *firstFree = slots.size();
+    }
+    // Triangular steps visit every slot of a power of two table exactly once
+    for (size_t i = 1; i <= slots.size(); i++) {
+        uint32_t ref = slots[pos].keyRef;
+        // If empty, stop trying
+        if (ref == COMPACT_EMPTY) {
+            if (firstFree != nullptr && *firstFree == slots.size()) {
+                *firstFree = pos;
+            }
+            return slots.size();
+        }
+        if (ref == COMPACT_REMOVED) {
+            if (firstFree != nullptr && *firstFree == slots.size()) {
+                *firstFree = pos;
+            }
+        } else if (keyMatches(ref, key)) {
+            return pos;
+        }
+        pos = (pos + i) & mask;
+    }
+    // The key was not in the table
+    return slots.size();
+}
+
+/**
+* insert adds <key, value> if the key isn't already there. Returns false if it was. The table
+* doubles once three quarters of the slots are full, and is rebuilt in place instead if it's
+* removed slots that are filling it up.
+*/
+
+bool CompactHashTable::insert(const std::string& key, uint32_t value) {
+    // Make room first so the free slot found below stays valid
+    if ((filled + removed + 1) * 4 > slots.size() * 3) {
+        rebuild((filled + 1) * 2 > slots.size() ? slots.size() * 2 : slots.size());
+    }
+    size_t free;
+    if (locate(key, &free) != slots.size()) {
+        return false;
+    }
+    if (slots[free].keyRef == COMPACT_REMOVED) {
+        removed--;
+    }
+    slots[free] = CompactSlot{makeRef(key, arena), value};
+    filled++;
+    return true;
+}
+
+/**
+* remove marks the key's slot removed. Its arena bytes stay where they are until the next rebuild.
+*/
+
+bool CompactHashTable::remove(const std::string& key) {
+    size_t pos = locate(key);
+    // The key was not in the table
+    if (pos == slots.size()) {
+        return false;
+    }
+    uint32_t ref = slots[pos].keyRef;
+    if ((ref & 3) == COMPACT_ARENA) {
+        deadBytes += key.size() + (key.size() < 0xFF ? 1 : 5);
+    }
+    slots[pos] = CompactSlot{COMPACT_REMOVED, 0};
+    filled--;
+    removed++;
+    return true;
+}
+
+/**
+* contains returns true if the key is in the table.
+*/
+
+bool CompactHashTable::contains(const string& key) const {
+    return locate(key) != slots.size();
+}
+
+/**
+* get returns the value for the key, or nullopt if it isn't in the table.
+*/
+
+optional<uint32_t> CompactHashTable::get(const string& key) const {
+    size_t pos = locate(key);
+    // The key was not in the table, return nullopt
+    if (pos == slots.size()) {
+        return nullopt;
+    }
+    return slots[pos].value;
+}
+
+/**
+* keys returns every key in the table, in slot order.
+*/
+
+vector<std::string> CompactHashTable::keys() const {
+    vector<string> keys;
+    keys.reserve(filled);
+    for (const CompactSlot& slot : slots) {
+        if (slot.keyRef != COMPACT_EMPTY && slot.keyRef != COMPACT_REMOVED) {
+            keys.emplace_back(keyAt(slot.keyRef));
+        }
+    }
+    return keys;
+}
+
+/**
+* capacity returns how many slots there are.
+*/
+
+size_t CompactHashTable::capacity() const {
+    return slots.size();
+}
+
+/**
+* size returns how many key-value pairs are in the table.
+*/
+
+size_t CompactHashTable::size() const {
+    return filled;
+}
+
+/**
+* alpha returns the load factor, how full the table is.
+*/
+
+double CompactHashTable::alpha() const {
+    return static_cast<double>(filled) / slots.size();
+}
+
+/**
+* memory_usage breaks the table's memory down the same way HashTable::memory_usage does. Inline
+* keys take no key bytes at all, and removed keys' arena bytes count as slack. An arena short
+* enough to sit in the std::string itself is already part of sizeof(CompactHashTable).
+*/
+
+HashTableMemory CompactHashTable::memory_usage() const {
+    HashTableMemory usage{filled, 0, 0, 0, 0, 0};
+    usage.bucketBytes = slots.size() * sizeof(CompactSlot);
+    usage.metadataBytes = sizeof(CompactHashTable);
+    // Spare vector capacity
+    usage.slackBytes = (slots.capacity() - slots.size()) * sizeof(CompactSlot);
+    // Only a heap allocated arena adds key bytes, spare capacity and removed keys on top
+    if (arena.capacity() > std::string().capacity()) {
+        usage.keyBytes = arena.size() - deadBytes;
+        usage.slackBytes += deadBytes + arena.capacity() + 1 - arena.size();
+    }
+    return usage;
+}
+
+/**
+* rebuild moves every pair into newCap fresh slots and a fresh arena, which drops the removed
+* slots and the dead arena bytes along the way.
+*/
+
+void CompactHashTable::rebuild(size_t newCap) {
+    vector<CompactSlot> oldSlots(newCap, CompactSlot{COMPACT_EMPTY, 0});
+    oldSlots.swap(slots);
+    std::string oldArena;
+    oldArena.swap(arena);
+    arena.reserve(oldArena.size() - deadBytes);
+    size_t mask = slots.size() - 1;
+    for (const CompactSlot& slot : oldSlots) {
+        if (slot.keyRef == COMPACT_EMPTY || slot.keyRef == COMPACT_REMOVED) {
+            continue;
+        }
+        // Short keys keep their reference, long ones are copied over to the new arena
+        uint32_t ref = slot.keyRef;
+        std::string key;
+        if ((ref & 3) == COMPACT_INLINE) {
+            key = keyAt(ref);
+        } else {
+            key = std::string(arenaKey(oldArena, ref));
+            ref = makeRef(key, arena);
+        }
+        // Every key is new to the fresh slots, so take the first empty one
+        size_t pos = hasher(key) & mask;
+        for (size_t i = 1; slots[pos].keyRef != COMPACT_EMPTY; i++) {
+            pos = (pos + i) & mask;
+        }
+        slots[pos] = CompactSlot{ref, slot.value};
+    }
+    removed = 0;
+    deadBytes = 0;
+}
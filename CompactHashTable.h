@@ -0,0 +1,74 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the header file for the CompactHashTable class. It's a HashTable squeezed down for
+* memory: values are 32 bits, every slot is 8 bytes, and the bucket state is packed into the low
+* bits of the key reference instead of taking its own byte. Keys up to 3 bytes are stored right in
+* the reference, longer keys are packed end to end in one arena string behind a length prefix, so
+* there's no per-key heap allocation. It probes triangular steps over a power of two capacity
+* instead of a shuffled offsets array, since the offsets alone would cost as much as the slots.
+* This file includes: The CompactHashTable constructors, the insert function, the remove
+* function, the contains function, the get function, the keys function, the capacity function,
+* the size function, the alpha function, the memory_usage function, the locate function, the
+* keyMatches function, the keyAt function, the arenaKey function, the inlineRef function, the
+* makeRef function, the rebuild function.
+* -----------------------------------------------------------------------------------------*/
+#pragma once
+
+#include "HashTable.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Key reference tags, in the low 2 bits of CompactSlot::keyRef
+constexpr uint32_t COMPACT_EMPTY = 0;
+constexpr uint32_t COMPACT_REMOVED = 1;
+constexpr uint32_t COMPACT_ARENA = 2;
+constexpr uint32_t COMPACT_INLINE = 3;
+// Longest key that fits in the reference itself
+constexpr size_t COMPACT_INLINE_MAX = 3;
+// The arena offset gets the 30 bits above the tag
+constexpr size_t COMPACT_ARENA_MAX = size_t(1) << 30;
+
+// One slot: a tagged key reference and the value
+struct CompactSlot {
+    uint32_t keyRef;
+    uint32_t value;
+};
+
+class CompactHashTable {
+    public:
+        // CompactHashTable variables
+        vector <CompactSlot> slots;
+        std::string arena;
+        size_t filled;
+        size_t removed;
+        size_t deadBytes;
+        // CompactHashTable constructor declarations
+        explicit CompactHashTable(size_t cap = 8);
+        explicit CompactHashTable(const HashTable& source);
+        // CompactHashTable function declarations
+        bool insert(const std::string& key, uint32_t value);
+        bool remove(const std::string& key);
+        bool contains(const string& key) const;
+        optional<uint32_t> get(const string& key) const;
+        vector<std::string> keys() const;
+        size_t capacity() const;
+        size_t size() const;
+        double alpha() const;
+        HashTableMemory memory_usage() const;
+        size_t locate(const std::string& key, size_t* firstFree = nullptr) const;
+        bool keyMatches(uint32_t ref, const std::string& key) const;
+        std::string keyAt(uint32_t ref) const;
+        static string_view arenaKey(const std::string& from, uint32_t ref);
+        static uint32_t inlineRef(const std::string& key);
+        static uint32_t makeRef(const std::string& key, std::string& into);
+        void rebuild(size_t newCap);
+        // Hasher declaration
+        std::hash<std::string> hasher;
+};
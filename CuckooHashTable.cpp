@@ -0,0 +1,370 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the cpp file for the CuckooHashTable class. It contains the constructor and all the
+* function definitions. This file includes: The CuckooHashTable constructor, the insert function,
+* the remove function, the contains function, the get function, the [] operator override, the
+* alpha function, the capacity function, the size function, the stashSize function, the find
+* functions, the place function, the hashOf function, the altGroup function, the makeSlot function,
+* the slotMatches function, the slotKey function, the grow function, the rebuild function.
+* -----------------------------------------------------------------------------------------*/
+
+#include "CuckooHashTable.h"
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Grow once more than this fraction of the slots are full, two slot groups fill up around 0.9
+constexpr double CUCKOO_MAX_LOAD = 0.85;
+
+/**
+* The constructor takes an initial capacity in slots, 8 if none is given. The number of groups is
+* rounded up to a power of two so picking a group is a mask instead of a divide.
+*/
+
+CuckooHashTable::CuckooHashTable(size_t cap) {
+    // Round the group count up to a power of two
+    size_t groupCount = 1;
+    while (groupCount * CUCKOO_GROUP_SLOTS < cap) {
+        groupCount *= 2;
+    }
+    // Every hash starts at 0, which means empty
+    groups.assign(groupCount, CuckooGroup{});
+    // Tracks size
+    filled = 0;
+    deadBytes = 0;
+    // Seed for picking which slot to kick out
+    kickState = 0x9E3779B97F4A7C15ULL;
+}
+
+/**
+* hashOf hashes a key the way the slots store it. A hash of 0 marks an empty slot, so a key that
+* really hashes to 0 is given 1 instead.
+*/
+
+uint64_t CuckooHashTable::hashOf(const string& key) const {
+    uint64_t hash = hasher(key);
+    return hash == 0 ? 1 : hash;
+}
+
+/**
+* altGroup returns a key's other group given either one of its groups and its hash. It's an xor
+* with a value made from the top of the hash, so calling it on the second group gives back the
+* first.
+*/
+
+size_t CuckooHashTable::altGroup(size_t group, uint64_t hash) const {
+    size_t tag = static_cast<size_t>(hash >> 32) | 1u;
+    return (group ^ (tag * 0x5BD1E995u)) & (groups.size() - 1);
+}
+
+/**
+* makeSlot fills in a slot for a new pair. A short key is copied right into the slot and a long
+* one is added to the end of the arena.
+*/
+
+CuckooSlot CuckooHashTable::makeSlot(const string& key, size_t value, uint64_t hash) {
+    CuckooSlot slot{};
+    slot.hash = hash;
+    slot.value = value;
+    if (key.size() <= CUCKOO_INLINE_KEY) {
+        memcpy(slot.key, key.data(), key.size());
+        slot.keyLength = static_cast<uint8_t>(key.size());
+    } else {
+        // Where the key starts in the arena and how long it is
+        uint64_t offset = arena.size();
+        uint32_t length = static_cast<uint32_t>(key.size());
+        memcpy(slot.key, &offset, sizeof(offset));
+        memcpy(slot.key + sizeof(offset), &length, sizeof(length));
+        slot.keyLength = CUCKOO_LONG_KEY;
+        arena += key;
+    }
+    return slot;
+}
+
+/**
+* slotKey returns a view of the slot's key, wherever it's kept. The view is good until the arena
+* changes.
+*/
+
+std::string_view CuckooHashTable::slotKey(const CuckooSlot& slot) const {
+    if (slot.keyLength != CUCKOO_LONG_KEY) {
+        return std::string_view(slot.key, slot.keyLength);
+    }
+    uint64_t offset;
+    uint32_t length;
+    memcpy(&offset, slot.key, sizeof(offset));
+    memcpy(&length, slot.key + sizeof(offset), sizeof(length));
+    return std::string_view(arena).substr(offset, length);
+}
+
+/**
+* slotMatches returns true if the slot holds key. The full hash is compared first, so a slot
+* holding another key is turned down without reading anything outside the slot, and a long key's
+* arena bytes are only read once the hash already matches.
+*/
+
+bool CuckooHashTable::slotMatches(const CuckooSlot& slot, const string& key, uint64_t hash) const {
+    if (slot.hash != hash) {
+        return false;
+    }
+    if (slot.keyLength != CUCKOO_LONG_KEY) {
+        return slot.keyLength == key.size() && memcmp(slot.key, key.data(), key.size()) == 0;
+    }
+    return slotKey(slot) == key;
+}
+
+/**
+* find checks the key's two groups and then the stash, and returns the key's slot or nullptr.
+* Each group is one cache line holding every slot's hash, value and short key, so a miss, or a hit
+* on a key of up to 15 bytes, never reads anything but those two lines.
+*/
+
+const CuckooSlot* CuckooHashTable::find(const string& key, uint64_t hash) const {
+    size_t first = hash & (groups.size() - 1);
+    size_t candidates[2] = {first, altGroup(first, hash)};
+    // Check both groups
+    for (size_t group : candidates) {
+        for (const CuckooSlot& slot : groups[group].slots) {
+            if (slotMatches(slot, key, hash)) {
+                return &slot;
+            }
+        }
+    }
+    // Check the stash
+    for (const CuckooSlot& slot : stash) {
+        if (slotMatches(slot, key, hash)) {
+            return &slot;
+        }
+    }
+    // The key was not in the table
+    return nullptr;
+}
+
+CuckooSlot* CuckooHashTable::find(const string& key, uint64_t hash) {
+    return const_cast<CuckooSlot*>(std::as_const(*this).find(key, hash));
+}
+
+/**
+* place puts a slot in a free spot in one of its two groups. If both are full it kicks a random
+* slot out to that slot's other group, and keeps going for up to CUCKOO_MAX_KICKS moves. Returns
+* true if everything found a spot, or false with slot left holding the one that didn't.
+*/
+
+bool CuckooHashTable::place(CuckooSlot& slot) {
+    size_t group = slot.hash & (groups.size() - 1);
+    for (size_t kick = 0; kick <= CUCKOO_MAX_KICKS; kick++) {
+        // Look for a free spot in this group, then in the other one
+        size_t candidates[2] = {group, altGroup(group, slot.hash)};
+        for (size_t g : candidates) {
+            for (CuckooSlot& spot : groups[g].slots) {
+                if (spot.hash == 0) {
+                    spot = slot;
+                    return true;
+                }
+            }
+        }
+        // Both full, swap with a random slot in one of them
+        kickState ^= kickState << 13;
+        kickState ^= kickState >> 7;
+        kickState ^= kickState << 17;
+        group = candidates[kickState & 1];
+        size_t s = (kickState >> 1) % CUCKOO_GROUP_SLOTS;
+        swap(groups[group].slots[s], slot);
+        // The kicked out slot now heads for its other group
+        group = altGroup(group, slot.hash);
+    }
+    // Ran out of kicks
+    return false;
+}
+
+/**
+* grow doubles the number of groups.
+*/
+
+void CuckooHashTable::grow() {
+    rebuild(groups.size() * 2);
+}
+
+/**
+* rebuild places every pair again in groupCount groups from its stored hash, so no key gets
+* rehashed, and packs the long keys into a fresh arena without the removed ones. If the stash
+* overflows while doing that it doubles the groups and tries again.
+*/
+
+void CuckooHashTable::rebuild(size_t groupCount) {
+    // Collect every live slot out of the groups and the stash
+    vector<CuckooSlot> live = stash;
+    for (const CuckooGroup& g : groups) {
+        for (const CuckooSlot& slot : g.slots) {
+            if (slot.hash != 0) {
+                live.push_back(slot);
+            }
+        }
+    }
+    // Copy only the long keys still in use into the new arena
+    std::string packed;
+    packed.reserve(arena.size() - deadBytes);
+    for (CuckooSlot& slot : live) {
+        if (slot.keyLength == CUCKOO_LONG_KEY) {
+            std::string_view key = slotKey(slot);
+            uint64_t offset = packed.size();
+            memcpy(slot.key, &offset, sizeof(offset));
+            packed += key;
+        }
+    }
+    arena.swap(packed);
+    deadBytes = 0;
+    bool fits = false;
+    while (!fits) {
+        // Start over with empty groups, twice as many each time it doesn't fit
+        groups.assign(groupCount, CuckooGroup{});
+        stash.clear();
+        fits = true;
+        for (CuckooSlot slot : live) {
+            if (place(slot)) {
+                continue;
+            }
+            if (stash.size() < CUCKOO_STASH_SIZE) {
+                stash.push_back(slot);
+            } else {
+                fits = false;
+                break;
+            }
+        }
+        groupCount *= 2;
+    }
+}
+
+/**
+* insert adds the pair if the key isn't already there and returns whether it did. A key that
+* can't be placed after all the kick-outs goes in the stash, and only when the stash is full
+* does the table grow.
+*/
+
+bool CuckooHashTable::insert(const std::string& key, const size_t& value) {
+    uint64_t hash = hashOf(key);
+    // If key is in the table, it doesn't get added
+    if (find(key, hash) != nullptr) {
+        return false;
+    }
+    // Keep the table from getting so full that every insert needs long kick chains
+    if (static_cast<double>(filled + 1) / static_cast<double>(capacity()) > CUCKOO_MAX_LOAD) {
+        grow();
+    }
+    // Place it, falling back to the stash and then to growing
+    CuckooSlot slot = makeSlot(key, value, hash);
+    if (!place(slot)) {
+        stash.push_back(slot);
+        if (stash.size() > CUCKOO_STASH_SIZE) {
+            grow();
+        }
+    }
+    // Increase size counter
+    filled++;
+    return true;
+}
+
+/**
+* remove clears the key's slot (or stash spot). There are no tombstones, a cleared slot is just
+* free again. A long key's bytes stay in the arena until there are enough of them to be worth
+* packing the arena again.
+*/
+
+bool CuckooHashTable::remove(const std::string& key) {
+    CuckooSlot* found = find(key, hashOf(key));
+    // The key was not in the table
+    if (found == nullptr) {
+        return false;
+    }
+    if (found->keyLength == CUCKOO_LONG_KEY) {
+        deadBytes += slotKey(*found).size();
+    }
+    // Clear its slot, or take it out of the stash
+    auto stashed = std::find_if(stash.begin(), stash.end(), [found](const CuckooSlot& slot) { return &slot == found; });
+    if (stashed != stash.end()) {
+        stash.erase(stashed);
+    } else {
+        *found = CuckooSlot{};
+    }
+    // Decrease size counter
+    filled--;
+    // Once most of the arena is removed keys, pack it at the same size
+    if (deadBytes > 4096 && deadBytes * 2 > arena.size()) {
+        rebuild(groups.size());
+    }
+    return true;
+}
+
+/**
+* contains returns true if the key is in the table.
+*/
+
+bool CuckooHashTable::contains(const string& key) const {
+    return find(key, hashOf(key)) != nullptr;
+}
+
+/**
+* get returns the key's value, or nullopt if the key isn't in the table.
+*/
+
+optional<size_t> CuckooHashTable::get(const string& key) const {
+    const CuckooSlot* found = find(key, hashOf(key));
+    // The key was not in the table, return nullopt
+    if (found == nullptr) {
+        return nullopt;
+    }
+    return found->value;
+}
+
+/**
+* The bracket operator returns a reference to the key's value, and throws an exception if the key
+* isn't in the table, the same as HashTable.
+*/
+
+size_t& CuckooHashTable::operator[](const string& key) {
+    CuckooSlot* found = find(key, hashOf(key));
+    // The key is not in the table, throw exception
+    if (found == nullptr) {
+        throw exception();
+    }
+    return found->value;
+}
+
+/**
+* alpha returns the load factor, size over slots.
+*/
+
+double CuckooHashTable::alpha() const {
+    return static_cast<double>(filled) / static_cast<double>(capacity());
+}
+
+/**
+* capacity returns how many slots there are across all groups.
+*/
+
+size_t CuckooHashTable::capacity() const {
+    return groups.size() * CUCKOO_GROUP_SLOTS;
+}
+
+/**
+* size returns how many key-value pairs are in the table.
+*/
+
+size_t CuckooHashTable::size() const {
+    return filled;
+}
+
+/**
+* stashSize returns how many keys are sitting in the stash.
+*/
+
+size_t CuckooHashTable::stashSize() const {
+    return stash.size();
+}
@@ -0,0 +1,88 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the header file for the CuckooHashTable class. Instead of probing bucket by bucket it
+* keeps its slots in 64 byte, cache line aligned groups and gives every key exactly two groups it
+* can be in, plus a small stash for the rare key that doesn't fit in either. Each slot holds the
+* key's full hash, its value and, for keys up to 15 bytes, the key itself, so looking up a short key
+* reads at most its two group cache lines (and the stash, which is almost always empty) no matter
+* how full the table is or whether the key is there. A longer key keeps its bytes in an arena
+* instead, so a hit on one also reads its bytes there to confirm it. This file includes: The
+* CuckooHashTable constructor, the insert function, the remove function, the contains function, the
+* get function, the [] operator override, the alpha function, the capacity function, the size
+* function, the stashSize function, the find functions, the place function, the hashOf function,
+* the altGroup function, the makeSlot function, the slotMatches function, the slotKey function, the
+* grow function, the rebuild function, the CuckooGroup and CuckooSlot classes.
+* -----------------------------------------------------------------------------------------*/
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Slots in one group, two 32 byte slots fill a 64 byte cache line
+constexpr size_t CUCKOO_GROUP_SLOTS = 2;
+// Longest key that's kept right in its slot
+constexpr size_t CUCKOO_INLINE_KEY = 15;
+// keyLength of a slot whose key lives in the arena
+constexpr uint8_t CUCKOO_LONG_KEY = 255;
+// Most keys that can sit in the stash before the table grows
+constexpr size_t CUCKOO_STASH_SIZE = 8;
+// Most kick-outs one insert tries before using the stash
+constexpr size_t CUCKOO_MAX_KICKS = 256;
+
+// One key-value pair. A hash of 0 means the slot is empty. A short key's bytes are in key, a long
+// key's arena offset and length are stored there instead.
+struct CuckooSlot {
+    uint64_t hash;
+    size_t value;
+    char key[CUCKOO_INLINE_KEY];
+    uint8_t keyLength;
+};
+
+// One cache line worth of slots
+struct alignas(64) CuckooGroup {
+    CuckooSlot slots[CUCKOO_GROUP_SLOTS];
+};
+
+static_assert(sizeof(CuckooSlot) == 32 && sizeof(CuckooGroup) == 64, "a group has to be one cache line");
+
+class CuckooHashTable {
+    public:
+        // CuckooHashTable variables
+        vector <CuckooGroup> groups;
+        vector <CuckooSlot> stash;
+        std::string arena;
+        size_t deadBytes;
+        size_t filled;
+        uint64_t kickState;
+        // CuckooHashTable constructor declaration
+        explicit CuckooHashTable(size_t cap = 8);
+        // CuckooHashTable function declarations
+        bool insert(const std::string& key, const size_t& value);
+        bool remove(const std::string& key);
+        bool contains(const string& key) const;
+        optional<size_t> get(const string& key) const;
+        size_t& operator[](const string& key);
+        double alpha() const;
+        size_t capacity() const;
+        size_t size() const;
+        size_t stashSize() const;
+        const CuckooSlot* find(const string& key, uint64_t hash) const;
+        CuckooSlot* find(const string& key, uint64_t hash);
+        bool place(CuckooSlot& slot);
+        uint64_t hashOf(const string& key) const;
+        size_t altGroup(size_t group, uint64_t hash) const;
+        CuckooSlot makeSlot(const string& key, size_t value, uint64_t hash);
+        bool slotMatches(const CuckooSlot& slot, const string& key, uint64_t hash) const;
+        std::string_view slotKey(const CuckooSlot& slot) const;
+        void grow();
+        void rebuild(size_t groupCount);
+        // Hasher declaration
+        std::hash<std::string> hasher;
+};
@@ -0,0 +1,360 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the cpp file for the DurableHashTable class. It contains the constructor and all the
+* function definitions. The table is kept in two files next to each other: path + ".snap" is the
+* last compacted snapshot and path + ".log" holds every operation since then. This file includes:
+* The DurableHashTable constructor and destructor, the open function, the close function, the isOpen
+* function, the insert function, the insert_or_assign function, the remove function, the expireAfter
+* function, the contains function, the get function, the size function, the commit function, the
+* compact function, the append function, the replay function, the logChecksum function.
+* -----------------------------------------------------------------------------------------*/
+
+#include "DurableHashTable.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Group commits also happen once this many bytes are waiting, whatever the operation count
+constexpr size_t DURABLE_PENDING_BYTES = 1u << 20;
+
+/**
+* The default constructor leaves the table closed. Nothing is logged until open is called.
+*/
+
+DurableHashTable::DurableHashTable() {
+    logFd = -1;
+    pendingOps = 0;
+    groupSize = DURABLE_GROUP_SIZE;
+    compactBytes = DURABLE_COMPACT_BYTES;
+    logBytes = 0;
+    syncs = 0;
+    replayed = 0;
+}
+
+/**
+* The destructor commits whatever is still waiting and closes the log.
+*/
+
+DurableHashTable::~DurableHashTable() {
+    close();
+}
+
+/**
+* open recovers the table stored at path: it loads path.snap if there is one, replays every
+* complete record in path.log on top of it, and cuts off a half written record at the end of the
+* log (from a crash in the middle of a write). After that every change is logged. group is how
+* many operations go in one group commit, and compactAt is the log size that triggers compact.
+* Returns false if the files can't be opened or the snapshot can't be read.
+*/
+
+bool DurableHashTable::open(const std::string& path, size_t group, size_t compactAt) {
+    close();
+    basePath = path;
+    groupSize = std::max<size_t>(group, 1);
+    compactBytes = compactAt;
+    // Start from the last snapshot, or from empty if there isn't one yet
+    table = HashTable();
+    if (filesystem::exists(basePath + ".snap")) {
+        optional<HashTable> loaded = HashTable::loadSnapshot(basePath + ".snap");
+        if (!loaded) {
+            return false;
+        }
+        table = std::move(*loaded);
+    }
+    // Open the log, making it if it's not there
+    int fd = ::open((basePath + ".log").c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    // Read the whole log in and replay it
+    string log;
+    struct stat st{};
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        log.resize(st.st_size);
+        if (pread(fd, log.data(), log.size(), 0) != static_cast<ssize_t>(log.size())) {
+            ::close(fd);
+            return false;
+        }
+    }
+    size_t good = replay(log);
+    // Anything after the last good record is a torn write, drop it so new records follow cleanly
+    if (good != log.size() && (ftruncate(fd, good) != 0 || fdatasync(fd) != 0)) {
+        ::close(fd);
+        return false;
+    }
+    logFd = fd;
+    logBytes = good;
+    return true;
+}
+
+/**
+* close commits anything still waiting and closes the log. Calling it on a closed table does
+* nothing.
+*/
+
+void DurableHashTable::close() {
+    if (logFd < 0) {
+        return;
+    }
+    commit();
+    ::close(logFd);
+    logFd = -1;
+}
+
+/**
+* isOpen returns whether the table has a log open.
+*/
+
+bool DurableHashTable::isOpen() const {
+    return logFd >= 0;
+}
+
+/**
+* insert adds a new key-value pair and logs it. Duplicate keys aren't allowed and aren't logged.
+* The insert is durable once its group is committed.
+*/
+
+bool DurableHashTable::insert(const std::string& key, const size_t& value) {
+    if (!table.insert(key, value)) {
+        return false;
+    }
+    append(LogOp::INSERT, key, value);
+    return true;
+}
+
+/**
+* insert_or_assign sets the key's value whether it's new or not and logs it. Returns true if the
+* key was new.
+*/
+
+bool DurableHashTable::insert_or_assign(const std::string& key, const size_t& value) {
+    bool inserted = table.insert_or_assign(key, value).second;
+    append(LogOp::ASSIGN, key, value);
+    return inserted;
+}
+
+/**
+* remove takes the key out and logs it. Returns false, and logs nothing, if the key wasn't there.
+*/
+
+bool DurableHashTable::remove(const std::string& key) {
+    if (!table.remove(key)) {
+        return false;
+    }
+    append(LogOp::REMOVE, key, 0);
+    return true;
+}
+
+/**
+* expireAfter gives the key a TTL and logs when it runs out as a wall clock time, since the table's
+* own expiry clock starts over with every process. Returns false, and logs nothing, if the key
+* wasn't there.
+*/
+
+bool DurableHashTable::expireAfter(const std::string& key, uint32_t seconds) {
+    if (!table.expireAfter(key, seconds)) {
+        return false;
+    }
+    append(LogOp::EXPIRE, key, HashTable::wallExpiry(table.table[table.locate(key)].expiry));
+    return true;
+}
+
+/**
+* contains returns true if the key is in the table.
+*/
+
+bool DurableHashTable::contains(const string& key) const {
+    return table.contains(key);
+}
+
+/**
+* get returns the key's value, or nullopt if it isn't in the table.
+*/
+
+optional<size_t> DurableHashTable::get(const string& key) const {
+    return table.get(key);
+}
+
+/**
+* size returns how many key-value pairs are in the table.
+*/
+
+size_t DurableHashTable::size() const {
+    return table.size();
+}
+
+/**
+* append adds one record to the group waiting to be written, and commits the group once it has
+* groupSize operations or gets big. A closed table changes in memory only.
+*/
+
+void DurableHashTable::append(LogOp op, const std::string& key, size_t value) {
+    if (logFd < 0) {
+        return;
+    }
+    LogRecord record{};
+    record.keyLength = static_cast<uint32_t>(key.size());
+    record.value = value;
+    record.op = op;
+    record.checksum = logChecksum(record, key.data());
+    pending.append(reinterpret_cast<const char*>(&record), sizeof(record));
+    pending.append(key);
+    pendingOps++;
+    // Group commit
+    if (pendingOps >= groupSize || pending.size() >= DURABLE_PENDING_BYTES) {
+        commit();
+    }
+}
+
+/**
+* commit writes every waiting record to the log with one write and makes it durable with one
+* fdatasync. If the log has grown past compactBytes it's compacted afterwards. Returns false if
+* the write or sync failed, in which case the records stay waiting.
+*/
+
+bool DurableHashTable::commit() {
+    if (logFd < 0) {
+        return false;
+    }
+    if (pending.empty()) {
+        return true;
+    }
+    // Write the whole group, picking up where a short write left off
+    size_t written = 0;
+    while (written < pending.size()) {
+        ssize_t n = ::write(logFd, pending.data() + written, pending.size() - written);
+        if (n < 0) {
+            // Whatever made it out is dropped from the group, so it isn't written twice
+            pending.erase(0, written);
+            return false;
+        }
+        written += n;
+    }
+    logBytes += written;
+    pending.clear();
+    pendingOps = 0;
+    // One flush for the whole group
+    if (fdatasync(logFd) != 0) {
+        return false;
+    }
+    syncs++;
+    if (compactBytes > 0 && logBytes >= compactBytes) {
+        return compact();
+    }
+    return true;
+}
+
+/**
+* compact writes the table to path.snap and empties the log. The snapshot is written to a
+* temporary file, flushed and renamed over the old one, so a crash at any point leaves either the
+* old snapshot with the full log or the new snapshot with a log whose records are all already in
+* it, and replaying those again gives the same table. Returns false if anything failed.
+*/
+
+bool DurableHashTable::compact() {
+    if (logFd < 0) {
+        return false;
+    }
+    // Everything in memory has to be in the log first
+    if (!pending.empty() && !commit()) {
+        return false;
+    }
+    // Write and flush the new snapshot
+    string temp = basePath + ".snap.tmp";
+    if (!table.saveSnapshot(temp)) {
+        return false;
+    }
+    int fd = ::open(temp.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool flushed = fsync(fd) == 0;
+    ::close(fd);
+    if (!flushed || rename(temp.c_str(), (basePath + ".snap").c_str()) != 0) {
+        return false;
+    }
+    // Make the rename itself durable
+    filesystem::path dir = filesystem::path(basePath).parent_path();
+    int dirFd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        ::close(dirFd);
+    }
+    // The snapshot has everything now, so the log starts over
+    if (ftruncate(logFd, 0) != 0 || fdatasync(logFd) != 0) {
+        return false;
+    }
+    logBytes = 0;
+    syncs++;
+    return true;
+}
+
+/**
+* replay applies every complete record in the log to the table and returns how many bytes of the
+* log were good. It stops at the first record that runs past the end or has a bad checksum.
+*/
+
+size_t DurableHashTable::replay(const std::string& log) {
+    size_t pos = 0;
+    replayed = 0;
+    while (pos + sizeof(LogRecord) <= log.size()) {
+        LogRecord record;
+        memcpy(&record, log.data() + pos, sizeof(record));
+        const char* key = log.data() + pos + sizeof(record);
+        // A record cut off partway, or one that was never fully written
+        if (record.keyLength > log.size() - pos - sizeof(record) || logChecksum(record, key) != record.checksum) {
+            break;
+        }
+        string k(key, record.keyLength);
+        switch (record.op) {
+            case LogOp::INSERT:
+                table.insert(k, record.value);
+                break;
+            case LogOp::ASSIGN:
+                table.insert_or_assign(k, record.value);
+                break;
+            case LogOp::REMOVE:
+                table.remove(k);
+                break;
+            case LogOp::EXPIRE:
+                // Whatever is left of the TTL now, which is nothing if it ran out while closed
+                table.expireAfter(k, HashTable::localExpiry(record.value) - HashTable::nowSeconds());
+                break;
+            default:
+                return pos;
+        }
+        pos += sizeof(record) + record.keyLength;
+        replayed++;
+    }
+    return pos;
+}
+
+/**
+* logChecksum is 32-bit FNV-1a over a record's fields and its key, so a torn or garbled record at
+* the end of the log isn't replayed.
+*/
+
+uint32_t DurableHashTable::logChecksum(const LogRecord& record, const char* key) {
+    uint32_t hash = 0x811C9DC5u;
+    auto mixIn = [&hash](const void* data, size_t length) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < length; i++) {
+            hash ^= bytes[i];
+            hash *= 0x01000193u;
+        }
+    };
+    mixIn(&record.keyLength, sizeof(record.keyLength));
+    mixIn(&record.value, sizeof(record.value));
+    mixIn(&record.op, sizeof(record.op));
+    mixIn(key, record.keyLength);
+    return hash;
+}
@@ -0,0 +1,76 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the header file for the DurableHashTable class. A DurableHashTable is a HashTable plus an
+* append-only log of every insert, remove, value change and TTL. Log records are buffered and
+* written with one fsync per group of operations (group commit), so durability costs one disk flush
+* per group instead of one per operation. compact writes the table out as a binary snapshot and
+* empties the log, and open rebuilds the table from the snapshot and replays the log after it. This
+* file includes: The DurableHashTable constructor and destructor, the open function, the close
+* function, the isOpen function, the insert function, the insert_or_assign function, the remove
+* function, the expireAfter function, the contains function, the get function, the size function,
+* the commit function, the compact function, the append function, the replay function, the
+* logChecksum function, the LogRecord class.
+* -----------------------------------------------------------------------------------------*/
+#pragma once
+
+#include "HashTable.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+// Operations the log records. EXPIRE's value is the wall clock second the key expires at
+enum class LogOp : uint8_t {INSERT = 1, REMOVE = 2, ASSIGN = 3, EXPIRE = 4};
+
+// Fixed size part of one log record, the key's bytes follow it
+struct LogRecord {
+    uint32_t checksum;
+    uint32_t keyLength;
+    uint64_t value;
+    LogOp op;
+    uint8_t pad[7];
+};
+
+// Default operations per group commit
+constexpr size_t DURABLE_GROUP_SIZE = 256;
+// Default log size that triggers a compaction
+constexpr size_t DURABLE_COMPACT_BYTES = 64u << 20;
+
+class DurableHashTable {
+    public:
+        // DurableHashTable variables
+        HashTable table;
+        std::string basePath;
+        int logFd;
+        std::string pending;
+        size_t pendingOps;
+        size_t groupSize;
+        size_t compactBytes;
+        size_t logBytes;
+        size_t syncs;
+        size_t replayed;
+        // DurableHashTable constructor and destructor declarations
+        DurableHashTable();
+        ~DurableHashTable();
+        DurableHashTable(const DurableHashTable&) = delete;
+        DurableHashTable& operator=(const DurableHashTable&) = delete;
+        // DurableHashTable function declarations
+        bool open(const std::string& path, size_t group = DURABLE_GROUP_SIZE, size_t compactAt = DURABLE_COMPACT_BYTES);
+        void close();
+        bool isOpen() const;
+        bool insert(const std::string& key, const size_t& value);
+        bool insert_or_assign(const std::string& key, const size_t& value);
+        bool remove(const std::string& key);
+        bool expireAfter(const std::string& key, uint32_t seconds);
+        bool contains(const string& key) const;
+        optional<size_t> get(const string& key) const;
+        size_t size() const;
+        bool commit();
+        bool compact();
+        void append(LogOp op, const std::string& key, size_t value);
+        size_t replay(const std::string& log);
+        static uint32_t logChecksum(const LogRecord& record, const char* key);
+};
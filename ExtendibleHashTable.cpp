@@ -0,0 +1,308 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the cpp file for the ExtendibleHashTable class. It contains the constructor and all the
+* function definitions. This file includes: The ExtendibleHashTable constructor, the insert
+* function, the remove function, the contains function, the get function, the [] operator
+* override, the keys function, the alpha function, the capacity function, the size function, the
+* segmentCount function, the directoryIndex function, the segmentFor function, the locate
+* function, the split function, the compactSegment function, the placeInto function.
+* -----------------------------------------------------------------------------------------*/
+
+#include "ExtendibleHashTable.h"
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+* The constructor starts with one segment of bucketsPerSegment buckets (256 if none is given) and
+* a directory with one entry. Every segment uses the same shuffled offsets.
+*/
+
+ExtendibleHashTable::ExtendibleHashTable(size_t bucketsPerSegment) {
+    segmentBuckets = std::max<size_t>(bucketsPerSegment, 8);
+    offsets = HashTable::offsetShuffle(segmentBuckets);
+    segments.push_back(make_unique<ExtendibleSegment>());
+    segments[0]->buckets.resize(segmentBuckets);
+    directory.assign(1, 0);
+    globalDepth = 0;
+    filled = 0;
+    splits = 0;
+}
+
+/**
+* directoryIndex returns the directory entry for a hash, which is its top globalDepth bits. The
+* low bits are left for picking the bucket inside the segment.
+*/
+
+size_t ExtendibleHashTable::directoryIndex(size_t hash) const {
+    return globalDepth == 0 ? 0 : static_cast<size_t>(static_cast<uint64_t>(hash) >> (64 - globalDepth));
+}
+
+/**
+* segmentFor returns the segment a hash belongs in.
+*/
+
+ExtendibleSegment& ExtendibleHashTable::segmentFor(size_t hash) const {
+    return *segments[directory[directoryIndex(hash)]];
+}
+
+/**
+* locate returns the bucket holding the key in the segment, or segmentBuckets if it isn't there.
+* If firstEmpty is given it's set to the first ESS or EAR bucket seen on the way.
+*/
+
+size_t ExtendibleHashTable::locate(const ExtendibleSegment& segment, const std::string& key, size_t hash, size_t* firstEmpty) const {
+    if (firstEmpty != nullptr) {
+        *firstEmpty = segmentBuckets;
+    }
+    size_t home = hash % segmentBuckets;
+    for (size_t i = 0; i < segmentBuckets; i++) {
+        size_t hole = (i == 0) ? home : (home + offsets[i - 1]) % segmentBuckets;
+        const HashTableBucket& bucket = segment.buckets[hole];
+        if (bucket.type == bucketType::NORMAL) {
+            if (bucket.bucketKey == key) {
+                return hole;
+            }
+            continue;
+        }
+        // Remember the first open bucket for insert
+        if (firstEmpty != nullptr && *firstEmpty == segmentBuckets) {
+            *firstEmpty = hole;
+        }
+        // If ESS, stop trying
+        if (bucket.type == bucketType::ESS) {
+            return segmentBuckets;
+        }
+    }
+    // The key was not in the segment
+    return segmentBuckets;
+}
+
+/**
+* insert puts a new key-value pair in the key's segment. Duplicate keys are not allowed. If the
+* segment is half used up it's split (or just cleaned out, if it's mostly tombstones) first, which
+* is the only growth step the table ever takes.
+*/
+
+bool ExtendibleHashTable::insert(const std::string& key, const size_t& value) {
+    size_t hash = hasher(key);
+    size_t open;
+    if (locate(segmentFor(hash), key, hash, &open) != segmentBuckets) {
+        return false;
+    }
+    // Grow one segment at a time until the key's segment has room
+    while (segmentFor(hash).used * 2 >= segmentBuckets) {
+        ExtendibleSegment& full = segmentFor(hash);
+        if (full.filled * 4 < segmentBuckets) {
+            // Mostly tombstones, so clearing them out makes enough room
+            compactSegment(full);
+        } else {
+            split(hash);
+        }
+    }
+    ExtendibleSegment& segment = segmentFor(hash);
+    locate(segment, key, hash, &open);
+    if (segment.buckets[open].type == bucketType::ESS) {
+        segment.used++;
+    }
+    segment.buckets[open].load(key, value);
+    segment.filled++;
+    filled++;
+    return true;
+}
+
+/**
+* placeInto moves a bucket's pair into the first open bucket on its probe sequence in the segment.
+*/
+
+void ExtendibleHashTable::placeInto(ExtendibleSegment& segment, HashTableBucket& bucket, size_t hash) {
+    size_t open;
+    locate(segment, bucket.bucketKey, hash, &open);
+    segment.buckets[open].takeFrom(bucket);
+    segment.filled++;
+    segment.used++;
+}
+
+/**
+* split divides the segment a hash belongs to into two by the next hash bit. If the segment
+* already uses as many bits as the directory has, the directory doubles first (every entry is
+* copied twice, no keys move). Only this one segment's keys are moved, into a fresh segment for
+* each half.
+*/
+
+void ExtendibleHashTable::split(size_t hash) {
+    uint32_t oldIndex = directory[directoryIndex(hash)];
+    uint32_t depth = segments[oldIndex]->localDepth;
+    // Keys that all share this many bits can't be told apart
+    if (depth >= EXTENDIBLE_MAX_DEPTH) {
+        throw exception();
+    }
+    // Double the directory if the segment is as deep as it is
+    if (depth == globalDepth) {
+        vector<uint32_t> doubled(directory.size() * 2);
+        for (size_t i = 0; i < directory.size(); i++) {
+            doubled[2 * i] = directory[i];
+            doubled[2 * i + 1] = directory[i];
+        }
+        directory = std::move(doubled);
+        globalDepth++;
+    }
+    // Two new halves, the low one reuses the old segment's number
+    unique_ptr<ExtendibleSegment> old = std::move(segments[oldIndex]);
+    auto low = make_unique<ExtendibleSegment>();
+    auto high = make_unique<ExtendibleSegment>();
+    low->buckets.resize(segmentBuckets);
+    high->buckets.resize(segmentBuckets);
+    low->localDepth = depth + 1;
+    high->localDepth = depth + 1;
+    // Bit depth from the top decides which half a key goes to
+    uint32_t bit = 63 - depth;
+    for (HashTableBucket& bucket : old->buckets) {
+        if (bucket.type == bucketType::NORMAL) {
+            size_t keyHash = hasher(bucket.bucketKey);
+            placeInto(((static_cast<uint64_t>(keyHash) >> bit) & 1) ? *high : *low, bucket, keyHash);
+        }
+    }
+    old.reset();
+    segments[oldIndex] = std::move(low);
+    auto highIndex = static_cast<uint32_t>(segments.size());
+    segments.push_back(std::move(high));
+    // The directory entries for the old segment are one run, the top half now goes to high
+    size_t span = size_t{1} << (globalDepth - depth);
+    size_t first = (directoryIndex(hash) >> (globalDepth - depth)) << (globalDepth - depth);
+    for (size_t i = first + span / 2; i < first + span; i++) {
+        directory[i] = highIndex;
+    }
+    splits++;
+}
+
+/**
+* compactSegment rebuilds a segment in place without its tombstones.
+*/
+
+void ExtendibleHashTable::compactSegment(ExtendibleSegment& segment) {
+    vector<HashTableBucket> old = std::move(segment.buckets);
+    segment.buckets = vector<HashTableBucket>(segmentBuckets);
+    segment.filled = 0;
+    segment.used = 0;
+    for (HashTableBucket& bucket : old) {
+        if (bucket.type == bucketType::NORMAL) {
+            placeInto(segment, bucket, hasher(bucket.bucketKey));
+        }
+    }
+}
+
+/**
+* remove takes the key out of its segment, leaving an EAR bucket. Returns false if the key wasn't
+* in the table.
+*/
+
+bool ExtendibleHashTable::remove(const std::string& key) {
+    size_t hash = hasher(key);
+    ExtendibleSegment& segment = segmentFor(hash);
+    size_t hole = locate(segment, key, hash);
+    // The key was not in the table
+    if (hole == segmentBuckets) {
+        return false;
+    }
+    segment.buckets[hole].load("", 0);
+    segment.buckets[hole].type = bucketType::EAR;
+    segment.filled--;
+    filled--;
+    return true;
+}
+
+/**
+* contains returns true if the key is in the table.
+*/
+
+bool ExtendibleHashTable::contains(const string& key) const {
+    size_t hash = hasher(key);
+    return locate(segmentFor(hash), key, hash) != segmentBuckets;
+}
+
+/**
+* get returns the key's value, or nullopt if it isn't in the table.
+*/
+
+optional<size_t> ExtendibleHashTable::get(const string& key) const {
+    size_t hash = hasher(key);
+    const ExtendibleSegment& segment = segmentFor(hash);
+    size_t hole = locate(segment, key, hash);
+    // The key was not in the table, return nullopt
+    if (hole == segmentBuckets) {
+        return nullopt;
+    }
+    return segment.buckets[hole].bucketValue;
+}
+
+/**
+* The bracket operator returns a reference to the key's value, and throws an exception if the key
+* isn't in the table, the same as HashTable.
+*/
+
+size_t& ExtendibleHashTable::operator[](const string& key) {
+    size_t hash = hasher(key);
+    ExtendibleSegment& segment = segmentFor(hash);
+    size_t hole = locate(segment, key, hash);
+    // The key is not in the table, throw exception
+    if (hole == segmentBuckets) {
+        throw exception();
+    }
+    return segment.buckets[hole].bucketValue;
+}
+
+/**
+* keys returns a copy of every key in the table.
+*/
+
+vector<std::string> ExtendibleHashTable::keys() const {
+    vector<string> keys;
+    keys.reserve(filled);
+    for (const unique_ptr<ExtendibleSegment>& segment : segments) {
+        for (const HashTableBucket& bucket : segment->buckets) {
+            if (!bucket.isEmpty()) {
+                keys.push_back(bucket.bucketKey);
+            }
+        }
+    }
+    return keys;
+}
+
+/**
+* alpha returns the load factor, size/capacity.
+*/
+
+double ExtendibleHashTable::alpha() const {
+    return static_cast<double>(filled) / static_cast<double>(capacity());
+}
+
+/**
+* capacity returns how many buckets there are across every segment.
+*/
+
+size_t ExtendibleHashTable::capacity() const {
+    return segments.size() * segmentBuckets;
+}
+
+/**
+* size returns how many key-value pairs are in the table.
+*/
+
+size_t ExtendibleHashTable::size() const {
+    return filled;
+}
+
+/**
+* segmentCount returns how many segments the table has.
+*/
+
+size_t ExtendibleHashTable::segmentCount() const {
+    return segments.size();
+}
@@ -0,0 +1,70 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the header file for the ExtendibleHashTable class. Instead of one bucket array that
+* doubles all at once, the table is a directory of fixed size segments, each probed the same way
+* HashTable probes its buckets. The top globalDepth bits of a key's hash pick its directory
+* entry, and when a segment gets half full only that segment is split in two. The directory
+* doubles now and then, but it only holds segment numbers, so growing never copies more than one
+* segment's keys at a time. This file includes: The ExtendibleHashTable constructor, the insert
+* function, the remove function, the contains function, the get function, the [] operator
+* override, the keys function, the alpha function, the capacity function, the size function, the
+* segmentCount function, the directoryIndex function, the segmentFor function, the locate function,
+* the split function, the compactSegment function, the placeInto function, the ExtendibleSegment
+* class.
+* -----------------------------------------------------------------------------------------*/
+#pragma once
+
+#include "HashTable.h"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Deepest a segment can split before the hash is clearly broken
+constexpr uint32_t EXTENDIBLE_MAX_DEPTH = 48;
+
+// One segment: a fixed size bucket array plus how many hash bits all of its keys share
+struct ExtendibleSegment {
+    vector <HashTableBucket> buckets;
+    size_t filled = 0;
+    size_t used = 0;
+    uint32_t localDepth = 0;
+};
+
+class ExtendibleHashTable {
+    public:
+        // ExtendibleHashTable variables
+        vector <size_t> offsets;
+        vector <unique_ptr<ExtendibleSegment>> segments;
+        vector <uint32_t> directory;
+        uint32_t globalDepth;
+        size_t segmentBuckets;
+        size_t filled;
+        size_t splits;
+        // ExtendibleHashTable constructor declaration
+        explicit ExtendibleHashTable(size_t bucketsPerSegment = 256);
+        // ExtendibleHashTable function declarations
+        bool insert(const std::string& key, const size_t& value);
+        bool remove(const std::string& key);
+        bool contains(const string& key) const;
+        optional<size_t> get(const string& key) const;
+        size_t& operator[](const string& key);
+        vector<std::string> keys() const;
+        double alpha() const;
+        size_t capacity() const;
+        size_t size() const;
+        size_t segmentCount() const;
+        size_t directoryIndex(size_t hash) const;
+        ExtendibleSegment& segmentFor(size_t hash) const;
+        size_t locate(const ExtendibleSegment& segment, const std::string& key, size_t hash, size_t* firstEmpty = nullptr) const;
+        void split(size_t hash);
+        void compactSegment(ExtendibleSegment& segment);
+        void placeInto(ExtendibleSegment& segment, HashTableBucket& bucket, size_t hash);
+        // Hasher declaration
+        std::hash<std::string> hasher;
+};
@@ -0,0 +1,347 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the header file for the FixedHashTable class template. A FixedHashTable has exactly N
+* buckets stored inline, keys of up to KeyCap characters stored inside the buckets, and never
+* touches the heap: insert reports that the table is full instead of resizing, and every function
+* is noexcept. It probes the same way HashTable does (home bucket, then shuffled offsets, ESS and
+* EAR buckets), with the offsets shuffled once in the constructor. At most 3/4 of the buckets hold
+* keys and at most 7/8 hold keys or tombstones, so a miss always reaches an ESS bucket within a
+* few probes, and the tombstones are cleared in place instead of being left to fill the table. This
+* file includes: The FixedHashTable constructor, the insert function, the insert_or_assign
+* function, the remove function, the contains function, the get function, the clear function, the
+* full function, the alpha function, the capacity function, the size function, the locate function,
+* the probe function, the rehash function, the FixedSlot class.
+* -----------------------------------------------------------------------------------------*/
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+using namespace std;
+
+// What insert did, since a fixed table can fail for reasons other than a duplicate
+enum class FixedInsert : uint8_t {INSERTED, EXISTS, FULL, KEY_TOO_LONG};
+
+// enum types for FixedHashTable buckets, same meaning as HashTable's bucketType. MOVING only shows
+// up partway through rehash, for a key that hasn't been put back yet
+enum class fixedType : uint8_t {NORMAL, ESS, EAR, MOVING};
+
+/**
+* One bucket of a FixedHashTable. The key's characters are copied into the bucket, so a full
+* table is one flat block of memory.
+*/
+
+template <size_t KeyCap>
+class FixedSlot {
+    public:
+        // FixedSlot variables
+        fixedType type = fixedType::ESS;
+        uint8_t length = 0;
+        char key[KeyCap];
+        size_t value = 0;
+        // FixedSlot function declarations
+        string_view keyView() const noexcept { return string_view(key, length); }
+};
+
+template <size_t N, size_t KeyCap = 32>
+class FixedHashTable {
+    public:
+        static_assert(N > 1, "a FixedHashTable needs at least two buckets");
+        static_assert(KeyCap > 0 && KeyCap <= 255, "key lengths are stored in one byte");
+        using Slot = FixedSlot<KeyCap>;
+        // Most keys the table holds, and most keys plus tombstones before they're cleared out
+        static constexpr size_t maxFilled = std::max<size_t>(N * 3 / 4, 1);
+        static constexpr size_t maxUsed = std::max<size_t>(N * 7 / 8, maxFilled);
+        // FixedHashTable variables
+        array<uint32_t, N - 1> offsets;
+        array<Slot, N> table;
+        size_t filled;
+        size_t tombstones;
+        // FixedHashTable constructor declaration
+        FixedHashTable() noexcept;
+        // FixedHashTable function declarations
+        FixedInsert insert(string_view key, size_t value) noexcept;
+        FixedInsert insert_or_assign(string_view key, size_t value) noexcept;
+        bool remove(string_view key) noexcept;
+        bool contains(string_view key) const noexcept;
+        optional<size_t> get(string_view key) const noexcept;
+        void clear() noexcept;
+        bool full() const noexcept;
+        double alpha() const noexcept;
+        size_t capacity() const noexcept;
+        size_t size() const noexcept;
+        size_t locate(string_view key, size_t* firstEmpty = nullptr) const noexcept;
+        size_t probe(size_t home, size_t i) const noexcept;
+        void rehash() noexcept;
+        // Hasher declaration
+        std::hash<string_view> hasher;
+};
+
+/**
+* The constructor marks every bucket ESS and shuffles the offsets 1..N-1. The shuffle uses a
+* small xorshift generator instead of random_device and mt19937 so it can't throw or allocate.
+*/
+
+template <size_t N, size_t KeyCap>
+FixedHashTable<N, KeyCap>::FixedHashTable() noexcept : filled(0), tombstones(0) {
+    // Every offset from 1 to N-1
+    for (size_t i = 0; i < N - 1; i++) {
+        offsets[i] = static_cast<uint32_t>(i + 1);
+    }
+    // Seed from where the table lives so different tables probe differently
+    uint64_t state = reinterpret_cast<uintptr_t>(this) | 1;
+    for (size_t i = N - 1; i > 1; i--) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        swap(offsets[i - 1], offsets[state % i]);
+    }
+}
+
+/**
+* probe returns the bucket for step i of the probe sequence starting at home.
+*/
+
+template <size_t N, size_t KeyCap>
+size_t FixedHashTable<N, KeyCap>::probe(size_t home, size_t i) const noexcept {
+    return (home + offsets[i]) % N;
+}
+
+/**
+* locate returns the bucket holding the key, or N if it isn't in the table. If firstEmpty is
+* given it's set to the first ESS or EAR bucket seen on the way, or N if there was none.
+*/
+
+template <size_t N, size_t KeyCap>
+size_t FixedHashTable<N, KeyCap>::locate(string_view key, size_t* firstEmpty) const noexcept {
+    if (firstEmpty != nullptr) {
+        *firstEmpty = N;
+    }
+    // Keys that are too long were never stored
+    if (key.size() > KeyCap) {
+        return N;
+    }
+    size_t home = hasher(key) % N;
+    for (size_t i = 0; i < N; i++) {
+        size_t hole = (i == 0) ? home : probe(home, i - 1);
+        const Slot& slot = table[hole];
+        if (slot.type == fixedType::NORMAL) {
+            if (slot.keyView() == key) {
+                return hole;
+            }
+            continue;
+        }
+        // Remember the first open bucket for insert
+        if (firstEmpty != nullptr && *firstEmpty == N) {
+            *firstEmpty = hole;
+        }
+        // If ESS, stop trying
+        if (slot.type == fixedType::ESS) {
+            return N;
+        }
+    }
+    // The key was not in the table
+    return N;
+}
+
+/**
+* insert puts <key, value> in the table. It never resizes: once maxFilled keys are in it returns
+* FULL, and a key longer than KeyCap gives KEY_TOO_LONG. A duplicate key gives EXISTS and the
+* value is left alone. If the new key would take an ESS bucket and push keys plus tombstones past
+* maxUsed, the tombstones are cleared out first.
+*/
+
+template <size_t N, size_t KeyCap>
+FixedInsert FixedHashTable<N, KeyCap>::insert(string_view key, size_t value) noexcept {
+    if (key.size() > KeyCap) {
+        return FixedInsert::KEY_TOO_LONG;
+    }
+    size_t open;
+    if (locate(key, &open) != N) {
+        return FixedInsert::EXISTS;
+    }
+    // Keep enough ESS buckets around that misses stay short
+    if (filled >= maxFilled) {
+        return FixedInsert::FULL;
+    }
+    if ((open == N || table[open].type == fixedType::ESS) && filled + tombstones >= maxUsed) {
+        rehash();
+        locate(key, &open);
+    }
+    // No open bucket anywhere on the key's probe sequence
+    if (open == N) {
+        return FixedInsert::FULL;
+    }
+    Slot& slot = table[open];
+    // Reusing a tombstone
+    if (slot.type == fixedType::EAR) {
+        tombstones--;
+    }
+    memcpy(slot.key, key.data(), key.size());
+    slot.length = static_cast<uint8_t>(key.size());
+    slot.value = value;
+    slot.type = fixedType::NORMAL;
+    filled++;
+    return FixedInsert::INSERTED;
+}
+
+/**
+* insert_or_assign sets the key's value whether it's new or not. Returns EXISTS if the key was
+* already there and its value was replaced, otherwise the same as insert.
+*/
+
+template <size_t N, size_t KeyCap>
+FixedInsert FixedHashTable<N, KeyCap>::insert_or_assign(string_view key, size_t value) noexcept {
+    size_t hole = locate(key);
+    if (hole != N) {
+        table[hole].value = value;
+        return FixedInsert::EXISTS;
+    }
+    return insert(key, value);
+}
+
+/**
+* remove marks the key's bucket EAR. Returns false if the key wasn't in the table.
+*/
+
+template <size_t N, size_t KeyCap>
+bool FixedHashTable<N, KeyCap>::remove(string_view key) noexcept {
+    size_t hole = locate(key);
+    // The key was not in the table
+    if (hole == N) {
+        return false;
+    }
+    table[hole].type = fixedType::EAR;
+    table[hole].length = 0;
+    filled--;
+    tombstones++;
+    return true;
+}
+
+/**
+* contains returns true if the key is in the table.
+*/
+
+template <size_t N, size_t KeyCap>
+bool FixedHashTable<N, KeyCap>::contains(string_view key) const noexcept {
+    return locate(key) != N;
+}
+
+/**
+* get returns the key's value, or nullopt if the key isn't in the table.
+*/
+
+template <size_t N, size_t KeyCap>
+optional<size_t> FixedHashTable<N, KeyCap>::get(string_view key) const noexcept {
+    size_t hole = locate(key);
+    // The key was not in the table, return nullopt
+    if (hole == N) {
+        return nullopt;
+    }
+    return table[hole].value;
+}
+
+/**
+* clear empties the table and sets every bucket back to ESS, which also clears out the tombstones
+* that remove leaves behind.
+*/
+
+template <size_t N, size_t KeyCap>
+void FixedHashTable<N, KeyCap>::clear() noexcept {
+    for (Slot& slot : table) {
+        slot.type = fixedType::ESS;
+        slot.length = 0;
+    }
+    filled = 0;
+    tombstones = 0;
+}
+
+/**
+* rehash clears every tombstone without moving the table anywhere else. Tombstones become ESS and
+* every key is marked MOVING, then each key is put back in the first ESS or MOVING bucket on its
+* probe sequence. Landing on a MOVING bucket swaps the two keys and carries on with the one that
+* was there, so every key that's been put back only has keys in front of it and lookups find it
+* again. Each swap puts one more key back, so it's O(N) probes per key at worst and needs no
+* extra memory.
+*/
+
+template <size_t N, size_t KeyCap>
+void FixedHashTable<N, KeyCap>::rehash() noexcept {
+    for (Slot& slot : table) {
+        slot.type = (slot.type == fixedType::NORMAL) ? fixedType::MOVING : fixedType::ESS;
+    }
+    for (size_t start = 0; start < N; start++) {
+        if (table[start].type != fixedType::MOVING) {
+            continue;
+        }
+        // Take the key out and free its bucket
+        Slot current = table[start];
+        table[start].type = fixedType::ESS;
+        bool placed = false;
+        while (!placed) {
+            size_t home = hasher(current.keyView()) % N;
+            for (size_t i = 0; i < N; i++) {
+                size_t hole = (i == 0) ? home : probe(home, i - 1);
+                Slot& slot = table[hole];
+                if (slot.type == fixedType::NORMAL) {
+                    continue;
+                }
+                current.type = fixedType::NORMAL;
+                if (slot.type == fixedType::ESS) {
+                    slot = current;
+                    placed = true;
+                } else {
+                    // A key that hasn't been put back yet, it goes next
+                    swap(slot, current);
+                }
+                break;
+            }
+        }
+    }
+    tombstones = 0;
+}
+
+/**
+* full returns true if the table holds maxFilled keys, so the next new key would get FULL.
+*/
+
+template <size_t N, size_t KeyCap>
+bool FixedHashTable<N, KeyCap>::full() const noexcept {
+    return filled >= maxFilled;
+}
+
+/**
+* alpha returns the load factor, size/capacity.
+*/
+
+template <size_t N, size_t KeyCap>
+double FixedHashTable<N, KeyCap>::alpha() const noexcept {
+    return static_cast<double>(filled) / static_cast<double>(N);
+}
+
+/**
+* capacity returns how many buckets the table has, which is always N.
+*/
+
+template <size_t N, size_t KeyCap>
+size_t FixedHashTable<N, KeyCap>::capacity() const noexcept {
+    return N;
+}
+
+/**
+* size returns how many key-value pairs are in the table.
+*/
+
+template <size_t N, size_t KeyCap>
+size_t FixedHashTable<N, KeyCap>::size() const noexcept {
+    return filled;
+}
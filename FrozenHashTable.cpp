@@ -0,0 +1,338 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the cpp file for the FrozenHashTable class. It contains the constructors and all the
+* function definitions. The perfect hash is built with hash-and-displace: keys are grouped by
+* hash, the biggest groups are placed first, and each group gets the first displacement that
+* drops all of its keys into free slots. This file includes: The FrozenHashTable constructors, the
+* contains function, the get function, the keys function, the capacity function, the size function,
+* the hashOf function, the slotFor function, the save function, the load function, the mix
+* function.
+* -----------------------------------------------------------------------------------------*/
+
+#include "FrozenHashTable.h"
+#include "HashTable.h"
+#include "HashTableSnapshot.h"
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Average number of keys that share a displacement value
+constexpr size_t FROZEN_GROUP_SIZE = 4;
+// How many displacements to try for one group before giving up
+constexpr uint32_t FROZEN_MAX_TRIES = 1u << 26;
+// How many seeds to try before deciding the keys can't be told apart
+constexpr uint64_t FROZEN_MAX_SEEDS = 64;
+// Magic bytes and version for saved frozen tables
+constexpr char FROZEN_MAGIC[8] = {'H', 'T', 'F', 'R', 'O', 'Z', 'E', '\0'};
+constexpr uint32_t FROZEN_VERSION = 2;
+
+// Fixed size header at the start of a saved frozen table
+struct FrozenHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t slotSize;
+    uint64_t hashCheck;
+    uint64_t count;
+    uint64_t groupCount;
+    uint64_t keyBytesSize;
+    uint64_t seed;
+};
+
+/**
+* The default constructor makes an empty frozen table. Every lookup misses.
+*/
+
+FrozenHashTable::FrozenHashTable() = default;
+
+/**
+* This constructor builds the frozen table from every key in a HashTable. No displacement can
+* split two different keys with exactly the same hash, so if any two tie the keys are hashed
+* again with the next seed until they all differ, starting from firstSeed (0 is plain std::hash).
+* Throws an exception if no seed in FROZEN_MAX_SEEDS tries tells them apart, or if the keys add
+* up to more than 4 GiB, since slots store their key offsets in 32 bits.
+*/
+
+FrozenHashTable::FrozenHashTable(const HashTable& source, uint64_t firstSeed) {
+    // Gather where every key lives in the source
+    vector <const HashTableBucket*> entries;
+    entries.reserve(source.size());
+    size_t totalKeyBytes = 0;
+    for (const HashTableBucket& bucket : source.table) {
+        if (bucket.isLive()) {
+            entries.push_back(&bucket);
+            totalKeyBytes += bucket.bucketKey.size();
+        }
+    }
+    // Offsets past 32 bits would be cut off and point at the wrong key, so refuse up front
+    if (totalKeyBytes > UINT32_MAX) {
+        throw exception();
+    }
+    size_t n = entries.size();
+    // Nothing to place
+    if (n == 0) {
+        return;
+    }
+    // Hash every key, moving on to the next seed while any two hashes are the same
+    vector <uint64_t> hashes(n);
+    vector <uint64_t> sorted;
+    for (seed = firstSeed; ; seed++) {
+        if (seed - firstSeed >= FROZEN_MAX_SEEDS) {
+            throw exception();
+        }
+        for (size_t e = 0; e < n; e++) {
+            hashes[e] = hashOf(entries[e]->bucketKey);
+        }
+        sorted = hashes;
+        sort(sorted.begin(), sorted.end());
+        if (adjacent_find(sorted.begin(), sorted.end()) == sorted.end()) {
+            break;
+        }
+    }
+    // Split the keys into groups by hash
+    size_t groupCount = (n + FROZEN_GROUP_SIZE - 1) / FROZEN_GROUP_SIZE;
+    vector <vector<uint32_t>> groups(groupCount);
+    for (uint32_t e = 0; e < n; e++) {
+        groups[hashes[e] % groupCount].push_back(e);
+    }
+    // Place the biggest groups first while there's still lots of room
+    vector <uint32_t> order(groupCount);
+    for (uint32_t g = 0; g < groupCount; g++) {
+        order[g] = g;
+    }
+    stable_sort(order.begin(), order.end(), [&groups](uint32_t a, uint32_t b) {
+        return groups[a].size() > groups[b].size();
+    });
+    displacements.assign(groupCount, 0);
+    vector <int64_t> placed(n, -1);
+    vector <bool> taken(n, false);
+    vector <size_t> positions;
+    for (uint32_t g : order) {
+        const vector<uint32_t>& group = groups[g];
+        // Empty groups are never looked at
+        if (group.empty()) {
+            break;
+        }
+        // Try displacements until every key in the group lands in its own free slot
+        bool done = false;
+        for (uint32_t d = 0; d < FROZEN_MAX_TRIES && !done; d++) {
+            positions.clear();
+            done = true;
+            for (uint32_t e : group) {
+                size_t pos = mix(hashes[e], d) % n;
+                // Slot is already used, or another key in this group wants it
+                if (taken[pos] || find(positions.begin(), positions.end(), pos) != positions.end()) {
+                    done = false;
+                    break;
+                }
+                positions.push_back(pos);
+            }
+            if (done) {
+                displacements[g] = d;
+                for (size_t j = 0; j < group.size(); j++) {
+                    taken[positions[j]] = true;
+                    placed[positions[j]] = group[j];
+                }
+            }
+        }
+        // Every hash is different, so this only happens if the tries run out
+        if (!done) {
+            throw exception();
+        }
+    }
+    // Lay the slots and key bytes out in slot order
+    slots.resize(n);
+    keyBytes.reserve(totalKeyBytes);
+    for (size_t pos = 0; pos < n; pos++) {
+        const HashTableBucket& bucket = *entries[placed[pos]];
+        slots[pos].keyOffset = static_cast<uint32_t>(keyBytes.size());
+        slots[pos].keyLength = static_cast<uint32_t>(bucket.bucketKey.size());
+        slots[pos].value = bucket.bucketValue;
+        keyBytes += bucket.bucketKey;
+    }
+}
+
+/**
+* mix scrambles a key's hash with a displacement so each displacement gives the group a new,
+* independent set of slots to try.
+*/
+
+uint64_t FrozenHashTable::mix(uint64_t hash, uint64_t seed) {
+    // splitmix64 finalizer over the hash and seed
+    uint64_t x = hash ^ (seed * 0x9E3779B97F4A7C15ULL);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/**
+* hashOf hashes a key the way this table does. With seed 0 that's std::hash. Any other seed
+* runs the key's bytes, 8 at a time, through mix with that seed, which gives keys that tie under
+* std::hash (or under another seed) a fresh, independent hash.
+*/
+
+uint64_t FrozenHashTable::hashOf(string_view key) const {
+    if (seed == 0) {
+        return hasher(key);
+    }
+    uint64_t hash = mix(key.size(), seed);
+    for (size_t pos = 0; pos < key.size(); pos += sizeof(uint64_t)) {
+        // The last word is padded with zeros, the length mixed in up front keeps that unambiguous
+        uint64_t word = 0;
+        memcpy(&word, key.data() + pos, std::min(sizeof(word), key.size() - pos));
+        hash = mix(hash ^ word, seed);
+    }
+    return hash;
+}
+
+/**
+* slotFor returns the one slot a key with this hash can be in.
+*/
+
+size_t FrozenHashTable::slotFor(uint64_t hash) const {
+    return mix(hash, displacements[hash % displacements.size()]) % slots.size();
+}
+
+/**
+* contains returns true if the key is in the frozen table. Only one slot is ever checked.
+*/
+
+bool FrozenHashTable::contains(const string& key) const {
+    return get(key).has_value();
+}
+
+/**
+* get returns the value for the key, or nullopt if it isn't in the frozen table. The perfect hash
+* sends every key somewhere, so the key in that slot is compared to catch misses.
+*/
+
+optional<size_t> FrozenHashTable::get(const string& key) const {
+    // An empty table has nothing in it
+    if (slots.empty()) {
+        return nullopt;
+    }
+    // Go straight to the only slot the key could be in
+    const FrozenSlot& slot = slots[slotFor(hashOf(key))];
+    // If the key matches, return the value
+    if (string_view(keyBytes).substr(slot.keyOffset, slot.keyLength) == key) {
+        return slot.value;
+    }
+    // The key was not in the table, return nullopt
+    return nullopt;
+}
+
+/**
+* keys returns every key in the frozen table, in slot order.
+*/
+
+vector<std::string> FrozenHashTable::keys() const {
+    vector<string> keys;
+    keys.reserve(slots.size());
+    for (const FrozenSlot& slot : slots) {
+        keys.push_back(keyBytes.substr(slot.keyOffset, slot.keyLength));
+    }
+    return keys;
+}
+
+/**
+* capacity returns how many slots there are. A frozen table has no empty slots, so this is
+* always the same as size.
+*/
+
+size_t FrozenHashTable::capacity() const {
+    return slots.size();
+}
+
+/**
+* size returns how many key-value pairs are in the frozen table.
+*/
+
+size_t FrozenHashTable::size() const {
+    return slots.size();
+}
+
+/**
+* save writes the frozen table to a binary file: a header, the displacements, the slots and the
+* key bytes. Returns false if the file couldn't be written.
+*/
+
+bool FrozenHashTable::save(const std::string& path) const {
+    // Open the file for binary output
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out) {
+        return false;
+    }
+    // Fill in the header
+    FrozenHeader header{};
+    memcpy(header.magic, FROZEN_MAGIC, sizeof(FROZEN_MAGIC));
+    header.version = FROZEN_VERSION;
+    header.slotSize = sizeof(FrozenSlot);
+    header.hashCheck = snapshotHashCheck();
+    header.count = slots.size();
+    header.groupCount = displacements.size();
+    header.keyBytesSize = keyBytes.size();
+    header.seed = seed;
+    // Write each section back to back
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(displacements.data()),
+              static_cast<streamsize>(displacements.size() * sizeof(uint32_t)));
+    out.write(reinterpret_cast<const char*>(slots.data()),
+              static_cast<streamsize>(slots.size() * sizeof(FrozenSlot)));
+    out.write(keyBytes.data(), static_cast<streamsize>(keyBytes.size()));
+    return out.flush().good();
+}
+
+/**
+* load reads a frozen table written by save. Returns nullopt if the file can't be read or was
+* written by a build that hashes keys differently.
+*/
+
+optional<FrozenHashTable> FrozenHashTable::load(const std::string& path) {
+    // Read the whole file in
+    ifstream in(path, ios::binary);
+    if (!in) {
+        return nullopt;
+    }
+    string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    if (data.size() < sizeof(FrozenHeader)) {
+        return nullopt;
+    }
+    // Check the header and that the sections add up to the file size
+    FrozenHeader header{};
+    memcpy(&header, data.data(), sizeof(header));
+    size_t displacementBytes = header.groupCount * sizeof(uint32_t);
+    size_t slotBytes = header.count * sizeof(FrozenSlot);
+    if (memcmp(header.magic, FROZEN_MAGIC, sizeof(FROZEN_MAGIC)) != 0
+        || header.version != FROZEN_VERSION
+        || header.slotSize != sizeof(FrozenSlot)
+        || header.hashCheck != snapshotHashCheck()
+        || (header.count == 0) != (header.groupCount == 0)
+        || sizeof(header) + displacementBytes + slotBytes + header.keyBytesSize != data.size()) {
+        return nullopt;
+    }
+    // Copy each section out
+    FrozenHashTable frozen;
+    const char* cursor = data.data() + sizeof(header);
+    frozen.displacements.resize(header.groupCount);
+    memcpy(frozen.displacements.data(), cursor, displacementBytes);
+    cursor += displacementBytes;
+    frozen.slots.resize(header.count);
+    memcpy(frozen.slots.data(), cursor, slotBytes);
+    cursor += slotBytes;
+    frozen.keyBytes.assign(cursor, header.keyBytesSize);
+    frozen.seed = header.seed;
+    // Make sure every slot's key actually lives inside the key bytes
+    for (const FrozenSlot& slot : frozen.slots) {
+        if (static_cast<uint64_t>(slot.keyOffset) + slot.keyLength > header.keyBytesSize) {
+            return nullopt;
+        }
+    }
+    return frozen;
+}
@@ -0,0 +1,55 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the header file for the FrozenHashTable class. A FrozenHashTable is a read-only copy of
+* a HashTable built with a minimal perfect hash, so there are exactly as many slots as keys and
+* every lookup checks a single slot. Keys are hashed with std::hash unless two of them share a
+* full 64 bit hash, in which case the table switches to its own seeded hash. This file includes:
+* The FrozenHashTable constructors, the contains function, the get function, the keys function,
+* the capacity function, the size function, the hashOf function, the slotFor function, the save
+* function, the load function, the mix function.
+* -----------------------------------------------------------------------------------------*/
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+class HashTable;
+
+// One slot per key, the key bytes themselves live in keyBytes, which can hold at most 4 GiB
+struct FrozenSlot {
+    uint32_t keyOffset;
+    uint32_t keyLength;
+    size_t value;
+};
+
+class FrozenHashTable {
+    public:
+        // FrozenHashTable variables
+        vector <uint32_t> displacements;
+        vector <FrozenSlot> slots;
+        std::string keyBytes;
+        uint64_t seed = 0;
+        // FrozenHashTable constructor declarations
+        FrozenHashTable();
+        explicit FrozenHashTable(const HashTable& source, uint64_t firstSeed = 0);
+        // FrozenHashTable function declarations
+        bool contains(const string& key) const;
+        optional<size_t> get(const string& key) const;
+        vector<std::string> keys() const;
+        size_t capacity() const;
+        size_t size() const;
+        uint64_t hashOf(string_view key) const;
+        size_t slotFor(uint64_t hash) const;
+        bool save(const std::string& path) const;
+        static optional<FrozenHashTable> load(const std::string& path);
+        static uint64_t mix(uint64_t hash, uint64_t seed);
+        // Hasher declaration
+        std::hash<std::string_view> hasher;
+};
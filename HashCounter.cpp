@@ -0,0 +1,147 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the cpp file for the HashCounter class. It contains the constructor and all the
+* function definitions. This file includes: The HashCounter constructor, the increment function,
+* the incrementAll functions, the count function, the topK function, the merge function, the
+* mergeAll function, the size function.
+* -----------------------------------------------------------------------------------------*/
+
+#include "HashCounter.h"
+#include <algorithm>
+#include <queue>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+* The constructor takes an initial capacity for the underlying table, 8 if none is given.
+*/
+
+HashCounter::HashCounter(size_t cap) : counts(cap) {}
+
+/**
+* increment adds delta to the key's count, starting it at delta if the key is new, and returns
+* the new count. This is a single probe instead of a contains followed by an operator[] walk.
+*/
+
+size_t HashCounter::increment(const std::string& key, size_t delta) {
+    return counts.upsert(key, delta, [delta](size_t& v) { v += delta; }).first.value();
+}
+
+/**
+* incrementAll counts every token in the vector once.
+*/
+
+void HashCounter::incrementAll(const vector<std::string>& tokens) {
+    for (const string& token : tokens) {
+        increment(token);
+    }
+}
+
+/**
+* This version reads whitespace separated tokens from a stream, reusing one string for every
+* token, and returns how many tokens it counted.
+*/
+
+size_t HashCounter::incrementAll(istream& in) {
+    size_t total = 0;
+    string token;
+    // Each read reuses the same string's buffer
+    while (in >> token) {
+        increment(token);
+        total++;
+    }
+    return total;
+}
+
+/**
+* count returns the key's count, 0 if it has never been counted.
+*/
+
+size_t HashCounter::count(const std::string& key) const {
+    return counts.get(key).value_or(0);
+}
+
+/**
+* topK returns the k keys with the highest counts, highest first. Ties are broken by key so the
+* result is always the same. A min-heap of size k keeps this O(n log k) with only k keys copied.
+*/
+
+vector<pair<std::string, size_t>> HashCounter::topK(size_t k) const {
+    // Orders by count, then by key in reverse, so the heap's top is the weakest entry
+    using Entry = pair<size_t, const string*>;
+    auto better = [](const Entry& a, const Entry& b) {
+        return a.first != b.first ? a.first > b.first : *a.second < *b.second;
+    };
+    priority_queue<Entry, vector<Entry>, decltype(better)> heap(better);
+    if (k == 0) {
+        return {};
+    }
+    // Keep the best k seen so far
+    for (auto it = counts.begin(); it != counts.end(); ++it) {
+        Entry entry{it.value(), &it.key()};
+        if (heap.size() < k) {
+            heap.push(entry);
+        } else if (better(entry, heap.top())) {
+            heap.pop();
+            heap.push(entry);
+        }
+    }
+    // Pop them out weakest first, then flip to highest first
+    vector<pair<string, size_t>> result;
+    result.reserve(heap.size());
+    while (!heap.empty()) {
+        result.emplace_back(*heap.top().second, heap.top().first);
+        heap.pop();
+    }
+    reverse(result.begin(), result.end());
+    return result;
+}
+
+/**
+* merge adds every count from other into this counter, one probe per key.
+*/
+
+void HashCounter::merge(const HashCounter& other) {
+    for (auto it = other.counts.begin(); it != other.counts.end(); ++it) {
+        increment(it.key(), it.value());
+    }
+}
+
+/**
+* mergeAll combines per-thread counters into one. The result starts as a copy of the biggest
+* part so its keys don't have to be inserted again.
+*/
+
+HashCounter HashCounter::mergeAll(const vector<HashCounter>& parts) {
+    // Nothing to merge
+    if (parts.empty()) {
+        return HashCounter();
+    }
+    // Start from the biggest part
+    size_t biggest = 0;
+    for (size_t i = 1; i < parts.size(); i++) {
+        if (parts[i].size() > parts[biggest].size()) {
+            biggest = i;
+        }
+    }
+    HashCounter result = parts[biggest];
+    // Fold in the rest
+    for (size_t i = 0; i < parts.size(); i++) {
+        if (i != biggest) {
+            result.merge(parts[i]);
+        }
+    }
+    return result;
+}
+
+/**
+* size returns how many different keys have been counted.
+*/
+
+size_t HashCounter::size() const {
+    return counts.size();
+}
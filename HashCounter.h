@@ -0,0 +1,35 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the header file for the HashCounter class. A HashCounter is a HashTable used as a
+* string -> count map, with every increment done in a single probe. This file includes: The
+* HashCounter constructor, the increment function, the incrementAll functions, the count function,
+* the topK function, the merge function, the mergeAll function, the size function.
+* -----------------------------------------------------------------------------------------*/
+#pragma once
+
+#include "HashTable.h"
+#include <istream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+class HashCounter {
+    public:
+        // HashCounter variables
+        HashTable counts;
+        // HashCounter constructor declaration
+        explicit HashCounter(size_t cap = 8);
+        // HashCounter function declarations
+        size_t increment(const std::string& key, size_t delta = 1);
+        void incrementAll(const vector<std::string>& tokens);
+        size_t incrementAll(istream& in);
+        size_t count(const std::string& key) const;
+        vector<pair<std::string, size_t>> topK(size_t k) const;
+        void merge(const HashCounter& other);
+        static HashCounter mergeAll(const vector<HashCounter>& parts);
+        size_t size() const;
+};
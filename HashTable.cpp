@@ -7,16 +7,41 @@
 * function, the resizeTable the remove function, the contains function, the get function,
 * the [] operator override, the keys function, the alpha function, the capacity function, the size
 * function, the printMe function, the << operator override, the probe function, the offsetShuffle
-* function, the HashTableBucket constructors, the load function, the isEmpty function.
+* function, the saveSnapshot functions, the loadSnapshot function, the freeze function, the begin
+* and end functions, the parallelParts function, the parallelRanges function, the purge function,
+* the emptySlot function, the dump function, the locate functions, the claim function, the find
+* functions, the try_emplace functions, the insert_or_assign function, the merge function, the
+* mergeAll function, the resolveConflict function, the capacityFor function, the enableFilter
+* function, the disableFilter function, the rebuildFilter function, the recordHot function, the
+* enableHotCache function, the disableHotCache function, the relocateHot function, the
+* setCapacityLimit function, the expireAfter function, the locateLive functions, the markUsed
+* function, the evictOne function, the makeRoom function, the trimToLimit function, the stats
+* function, the nowSeconds function, the wallSeconds function, the wallExpiry function, the
+* localExpiry function, the isExpired function, the addExpiry function, the dropExpiry function, the
+* expiredCount function, the entryBytes function, the rebuild function, the enableOrderedIndex
+* function, the disableOrderedIndex function, the range function, the prefix function, the orderLess
+* function, the orderChunkFor function, the orderAdd function, the orderInsert function, the
+* orderErase function, the orderMove function, the flushOrder function, the orderLayout function,
+* the rebuildOrder function, the setPageMode function, the shuffleOffsets function, the memory_usage
+* function, the HashTableBucket constructors, the load function, the isEmpty function, the isLive
+* function, the takeFrom function.
 * -----------------------------------------------------------------------------------------*/
 
 #include "HashTable.h"
+#include "FrozenHashTable.h"
+#include "HashTableSnapshot.h"
+#include <cstring>
 #include <exception>
+#include <fstream>
 #include <string>
 #include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
 #include <iostream>
 #include <iterator>
 #include <random>
+#include <thread>
 #include <vector>
 
 using namespace std;
@@ -28,6 +53,8 @@ using namespace std;
 
 // Constructor for the HashTable
 HashTable::HashTable(size_t cap) {
+    // Normal heap memory until setPageMode is called
+    pageMode = PageMode::DEFAULT;
     // Sets capacity
     table.resize(cap);
     // Tracks size
@@ -35,7 +62,18 @@ HashTable::HashTable(size_t cap) {
     // Tracks capacity
     max = cap;
     // Makes offsets vector
-    offsets = offsetShuffle(cap);
+    shuffleOffsets(cap);
+    // No filter until enableFilter is called
+    filterBitsPerKey = 0;
+    // Unbounded until setCapacityLimit is called
+    usedBytes = 0;
+    maxEntries = 0;
+    maxBytes = 0;
+    clockHand = 0;
+    evictedSincePurge = 0;
+    counters = HashTableStats{};
+    // No ordered index until enableOrderedIndex is called
+    orderEnabled = false;
 }
 
 /**
@@ -46,61 +84,13 @@ HashTable::HashTable(size_t cap) {
 */
 
 bool HashTable::insert(const std::string& key, const size_t& value) {
-    // If key is in the table, it doesn't get added
-    if (contains(key)) {
-        return false;
-    }
-    // If the table is half full it gets expanded
-    if (alpha() >= 0.5) {
-        resizeTable();
-    }
-    // Hash the key
-    size_t home = hasher(key) % max;
-    // If the home index is open
-    if (table[home].isEmpty()) {
-        // Load in the key pair
-        table[home].load(key, value);
-        // Increase size counter
-        filled++;
-        return true;
-    }
-    // You can't insert at the home index
-    for (int i = 0; i < max - 1; i++) {
-        // Begin the probe
-        auto hole = probe(home, i);
-        // If the probed index is open
-        if (table[hole].isEmpty()) {
-            // Load in the key pair
-            table[hole].load(key, value);
-            // Increase size counter
-            filled++;
-            return true;
-        }
-    }
-    // I'm not sure that it's possible to reach this return but if it's not here I get a warning
-    // and I don't like warnings
-    return false;
+    // try_emplace does the duplicate check and the insert in the same probe
+    return try_emplace(key, value).second;
 }
 
 void HashTable::resizeTable() {
-    // Increase capacity counter
-    max *= 2;
-    // Increase capacity
-    vector <HashTableBucket> oldTable = table;
-    // Shuffle the offset values
-    offsets = offsetShuffle(max);
-    // Clear the table
-    table.clear();
-    // Set the table capacity
-    table.resize(max);
-    // Set filled to 0
-    filled = 0;
-    // Re-hash every value from the old table into the expanded one
-    for (int i = 0; i < oldTable.size(); i++) { // NOLINT(*-loop-convert)
-        if (!oldTable[i].isEmpty()) {
-            this->insert(oldTable[i].bucketKey, oldTable[i].bucketValue);
-        }
-    }
+    // Double the capacity and move every pair across
+    rebuild(max * 2);
 }
 
 /**
@@ -109,46 +99,30 @@ void HashTable::resizeTable() {
 */
 
 bool HashTable::remove(const std::string& key) {
-    // If the key is in the table it gets removed
-    if (contains(key)) {
-        // Hash the key
-        size_t home = hasher(key) % max;
-        // If the key is at the home index
-        if (table[home].bucketKey == key) {
-            // Set the key to a blank string and the value to 0
-            table[home].load("", 0);
-            // Set the bucket type to Empty After Removal
-            table[home].type = bucketType::EAR;
-            // Decrease size counter
-            filled--;
-            return true;
-        }
-        // If EES, stop trying
-        if (table[home].type == bucketType::ESS) {
-            return false;
-        }
-        // If the key is not at the home index
-        for (int i = 0; i < max - 1; i++) {
-            // Begin the probe
-            auto hole = probe(home, i);
-            // If the key is at the probed index
-            if (table[hole].bucketKey == key) {
-                // Set the key to a blank string and the value to 0
-                table[hole].load("", 0);
-                // Set the bucket type to Empty After Removal
-                table[hole].type = bucketType::EAR;
-                // Decrease size counter
-                filled--;
-                return true;
-            }
-            // If ESS, stop trying
-            if (table[hole].type == bucketType::ESS) {
-                return false;
-            }
-        }
-    }
+    // Find the key's bucket
+    size_t hole = locate(key);
     // The key was not in the table
-    return false;
+    if (hole == max) {
+        return false;
+    }
+    // An expired key isn't really in the table, but clear it out while we're here
+    bool live = !isExpired(table[hole]);
+    if (!live) {
+        counters.expirations++;
+    }
+    usedBytes -= entryBytes(table[hole].bucketKey);
+    dropExpiry(table[hole].expiry);
+    // Take it out of the ordered index while its key is still there to find it by
+    if (orderEnabled) {
+        orderErase(hole);
+    }
+    // Set the key to a blank string and the value to 0
+    table[hole].load("", 0);
+    // Set the bucket type to Empty After Removal
+    table[hole].type = bucketType::EAR;
+    // Decrease size counter
+    filled--;
+    return live;
 }
 
 /**
@@ -157,31 +131,8 @@ bool HashTable::remove(const std::string& key) {
 */
 
 bool HashTable::contains(const string& key) const {
-    // Hash the key
-    size_t home = hasher(key) % max;
-    // If the key is at the home index
-    if (table[home].bucketKey == key) {
-        return true;
-    }
-    // If ESS, stop trying
-    if (table[home].type == bucketType::ESS) {
-        return false;
-    }
-    // If the key is not at the home index
-    for (int i = 0; i < max - 1; i++) {
-        // Begin the probe
-        auto hole = probe(home, i);
-        // If the key is at the probed index
-        if (table[hole].bucketKey == key) {
-            return true;
-        }
-        // If ESS, stop trying
-        if (table[hole].type == bucketType::ESS) {
-            return false;
-        }
-    }
-    // The key was not in the table
-    return false;
+    // The key is in the table if locate found a live bucket for it
+    return locateLive(key) != max;
 }
 
 /**
@@ -195,36 +146,14 @@ bool HashTable::contains(const string& key) const {
 */
 
 std::optional<size_t> HashTable::get(const string& key) const {
-    // If the key is in the table the value is retrieved
-    if (contains(key)) {
-        // Hash the key
-        size_t home = hasher(key) % max;
-        // If the key is at the home index
-        if (table[home].bucketKey == key) {
-            // Return the key value
-            return table[home].bucketValue;
-        }
-        // If ESS, stop trying
-        if (table[home].type == bucketType::ESS) {
-            return nullopt;
-        }
-        // If the key is not at the home index
-        for (int i = 0; i < max - 1; i++) {
-            // Begin the probe
-            auto hole = probe(home, i);
-            // If the key is at the probed index
-            if (table[hole].bucketKey == key) {
-                // Return the key value
-                return table[hole].bucketValue;
-            }
-            // If ESS, stop trying
-            if (table[hole].type == bucketType::ESS) {
-                return nullopt;
-            }
-        }
-    }
+    // Find the key's bucket
+    size_t hole = locateLive(key);
     // The key was not in the table, return nullopt
-    return nullopt;
+    if (hole == max) {
+        return nullopt;
+    }
+    // Return the key value
+    return table[hole].bucketValue;
 }
 
 /**
@@ -242,36 +171,14 @@ std::optional<size_t> HashTable::get(const string& key) const {
 */
 
 size_t& HashTable::operator[](const string& key) {
-    // If the table contains the key, reference the value
-    if (contains(key)) {
-        // Hash the key
-        size_t home = hasher(key) % max;
-        // If the key is at the home index
-        if (table[home].bucketKey == key) {
-            // Return the key value
-            return table[home].bucketValue;
-        }
-        // If ESS, stop trying
-        if (table[home].type == bucketType::ESS) {
-            throw exception();
-        }
-        // If the key is not at the home index
-        for (int i = 0; i < max - 1; i++) {
-            // Begin the probe
-            auto hole = probe(home, i);
-            // If the key is at the probed index
-            if (table[hole].bucketKey == key) {
-                // Return the key value
-                return table[hole].bucketValue;
-            }
-            // If ESS, stop trying
-            if (table[home].type == bucketType::ESS) {
-                throw exception();
-            }
-        }
-    }
+    // Find the key's bucket
+    size_t hole = locateLive(key);
     // The key is not in the table, throw exception
-    throw exception();
+    if (hole == max) {
+        throw exception();
+    }
+    // Return the key value
+    return table[hole].bucketValue;
 }
 
 /**
@@ -283,15 +190,11 @@ size_t& HashTable::operator[](const string& key) {
 std::vector<std::string> HashTable::keys() const {
     // Make a vector for the keys
     vector<string> keys;
-    // Give the vector space for the keys
-    keys.reserve(max);
-    // Check each bucket for a key
-    for (int i = 0; i < max; i++) {
-        // If the bucket is not empty
-        if (!table[i].isEmpty()) {
-            // Add key to the vector
-            keys.push_back(table[i].bucketKey);
-        }
+    // Only full buckets end up in here, so size is all the space needed
+    keys.reserve(filled);
+    // Add every key the iterators walk over
+    for (auto it = begin(); it != end(); ++it) {
+        keys.push_back(it.key());
     }
     // Return the vector of keys
     return keys;
@@ -322,13 +225,15 @@ size_t HashTable::capacity() const {
 }
 
 /**
-* The size method returns how many key-value pairs are in the hash table. The
-* time complexity for this method must be O(1)
+* The size method returns how many key-value pairs are in the hash table. Keys
+* that have expired aren't counted, even before they're reaped, so size() always
+* matches keys() and iteration. It's O(1) when no key has an expiry, and otherwise
+* costs one step per distinct expiry second that has passed but not been reaped.
 */
 
 size_t HashTable::size() const {
     // Return size
-    return filled;
+    return filled - expiredCount();
 }
 
 /**
@@ -350,8 +255,8 @@ size_t HashTable::size() const {
 */
 
 std::string HashTable::printMe(int i) const {
-    // If the bucket is not empty
-    if (!table[i].isEmpty()) {
+    // If the bucket holds a live pair
+    if (table[i].isLive()) {
         // Incredibly long line that puts a whole bucket into a string
         string s = "Bucket " + to_string(i) + ": <" + table[i].bucketKey + ", " + to_string(table[i].bucketValue) + ">";
         // Return the string
@@ -362,18 +267,111 @@ std::string HashTable::printMe(int i) const {
 }
 
 ostream& operator<<(ostream& os, const HashTable& hashTable) {
-    // For the capacity of the table
-    for (int i = 0; i < hashTable.capacity(); i++) {
-        // If the printMe string isn't empty
-        if (!hashTable.printMe(i).empty()) {
-            // Print the printMe string
-            os << hashTable.printMe(i) << endl;
-        }
-    }
+    // Print the same lines printMe would, without building a string per bucket
+    hashTable.dump(os, DumpFormat::TEXT);
     // Returns the ostream... I guess.
     return os;
 }
 
+// Appends a number to the dump buffer without making a temporary string
+static void appendNumber(string& buffer, size_t number) {
+    char digits[24];
+    auto result = to_chars(digits, digits + sizeof(digits), number);
+    buffer.append(digits, result.ptr);
+}
+
+// Appends a CSV field, quoting it only if it has a comma, quote or line break in it
+static void appendCsv(string& buffer, const string& field) {
+    if (field.find_first_of(",\"\r\n") == string::npos) {
+        buffer += field;
+        return;
+    }
+    buffer += '"';
+    for (char c : field) {
+        // Quotes inside a quoted field are doubled
+        if (c == '"') {
+            buffer += '"';
+        }
+        buffer += c;
+    }
+    buffer += '"';
+}
+
+// Appends a JSON string, escaping quotes, backslashes and control characters
+static void appendJson(string& buffer, const string& field) {
+    static const char hex[] = "0123456789abcdef";
+    buffer += '"';
+    for (char c : field) {
+        auto byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            buffer += '\\';
+            buffer += c;
+        } else if (byte < 0x20) {
+            buffer += "\\u00";
+            buffer += hex[byte >> 4];
+            buffer += hex[byte & 0xF];
+        } else {
+            buffer += c;
+        }
+    }
+    buffer += '"';
+}
+
+/**
+* dump writes every key-value pair to the stream along with the bucket it's in. TEXT gives the
+* same lines as operator<< (Bucket 5: <James, 4815>), CSV gives a bucket,key,value header and one
+* row per pair, and JSONL gives one JSON object per line. Everything goes through one reused
+* buffer that is only written out when it fills up, so there's no allocation or flush per pair.
+*/
+
+void HashTable::dump(ostream& os, DumpFormat format) const {
+    // Write the buffer out once it gets this big
+    constexpr size_t FLUSH_AT = 64 * 1024;
+    string buffer;
+    buffer.reserve(FLUSH_AT + 256);
+    // CSV gets a header row
+    if (format == DumpFormat::CSV) {
+        buffer += "bucket,key,value\n";
+    }
+    for (auto it = begin(); it != end(); ++it) {
+        switch (format) {
+            case DumpFormat::TEXT:
+                buffer += "Bucket ";
+                appendNumber(buffer, it.index());
+                buffer += ": <";
+                buffer += it.key();
+                buffer += ", ";
+                appendNumber(buffer, it.value());
+                buffer += ">\n";
+                break;
+            case DumpFormat::CSV:
+                appendNumber(buffer, it.index());
+                buffer += ',';
+                appendCsv(buffer, it.key());
+                buffer += ',';
+                appendNumber(buffer, it.value());
+                buffer += '\n';
+                break;
+            case DumpFormat::JSONL:
+                buffer += "{\"bucket\":";
+                appendNumber(buffer, it.index());
+                buffer += ",\"key\":";
+                appendJson(buffer, it.key());
+                buffer += ",\"value\":";
+                appendNumber(buffer, it.value());
+                buffer += "}\n";
+                break;
+        }
+        // Hand a full buffer to the stream and reuse it
+        if (buffer.size() >= FLUSH_AT) {
+            os.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    }
+    // Write whatever is left
+    os.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+}
+
 size_t HashTable::probe(size_t home, int i) const {
     return (home + offsets[i]) % table.size();
 }
@@ -396,58 +394,1439 @@ vector <size_t> HashTable::offsetShuffle(size_t newCap) {
     return newOffsets;
 }
 
-//BUCKET
+/**
+* saveSnapshot writes the whole table to a binary file in one streaming pass: a header, the probe
+* offsets, one fixed size record per bucket (state, hash, value and where its key lives) and then
+* all the key bytes back to back. The file can be reloaded with loadSnapshot or opened in place
+* with MappedHashTable. Returns false if the file couldn't be written.
+*/
+
+bool HashTable::saveSnapshot(const std::string& path) const {
+    // Open the file for binary output
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out) {
+        return false;
+    }
+    // Write the snapshot and make sure it all made it to disk
+    return saveSnapshot(out) && out.flush().good();
+}
+
+bool HashTable::saveSnapshot(ostream& os) const {
+    // Work out where every section starts before writing anything
+    SnapshotHeader header{};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.recordSize = sizeof(SnapshotBucket);
+    header.capacity = max;
+    header.hashCheck = snapshotHashCheck();
+    header.offsetsPos = sizeof(SnapshotHeader);
+    header.bucketsPos = header.offsetsPos + offsets.size() * sizeof(uint64_t);
+    header.keysPos = header.bucketsPos + table.size() * sizeof(SnapshotBucket);
+    // Total up the live pairs and key bytes so the header knows the final file size
+    uint64_t keyBytes = 0;
+    header.filled = 0;
+    for (const HashTableBucket& bucket : table) {
+        if (bucket.isLive()) {
+            keyBytes += bucket.bucketKey.size();
+            header.filled++;
+        }
+    }
+    header.fileSize = header.keysPos + keyBytes;
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    // Write the probe offsets
+    for (size_t offset : offsets) {
+        uint64_t stored = offset;
+        os.write(reinterpret_cast<const char*>(&stored), sizeof(stored));
+    }
+    // Write one record per bucket, keeping track of where each key will land
+    uint64_t keyOffset = 0;
+    for (const HashTableBucket& bucket : table) {
+        SnapshotBucket record{};
+        record.type = static_cast<uint8_t>(bucket.type);
+        // Only live buckets carry a key, hash and value, an expired one is saved as removed
+        if (bucket.isLive()) {
+            record.hash = hasher(bucket.bucketKey);
+            record.value = bucket.bucketValue;
+            record.keyOffset = keyOffset;
+            record.keyLength = static_cast<uint32_t>(bucket.bucketKey.size());
+            // The TTL is written as a wall clock time so it still means something after a restart
+            record.expiresAt = wallExpiry(bucket.expiry);
+            keyOffset += bucket.bucketKey.size();
+        } else if (bucket.type == bucketType::NORMAL) {
+            record.type = static_cast<uint8_t>(bucketType::EAR);
+        }
+        os.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    }
+    // Write the keys in the same order as the records
+    for (const HashTableBucket& bucket : table) {
+        if (bucket.isLive()) {
+            os.write(bucket.bucketKey.data(), static_cast<streamsize>(bucket.bucketKey.size()));
+        }
+    }
+    return os.good();
+}
 
 /**
-* The default constructor can simply set the bucket type to ESS.
+* loadSnapshot rebuilds a HashTable from a file written by saveSnapshot. The buckets and offsets
+* are restored exactly as they were saved, so nothing gets rehashed. Keys with a TTL keep it, and
+* one that ran out while the table was on disk comes back already expired. Returns nullopt if the file
+* can't be read or wasn't written by a compatible build.
 */
 
-HashTableBucket::HashTableBucket() {
-    // Sets value to zero
-    bucketValue = 0;
-    // Sets type to Empty Since Start
-    type = bucketType::ESS;
+optional<HashTable> HashTable::loadSnapshot(const std::string& path) {
+    // Read the whole file in
+    ifstream in(path, ios::binary);
+    if (!in) {
+        return nullopt;
+    }
+    string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    if (data.size() < sizeof(SnapshotHeader)) {
+        return nullopt;
+    }
+    // Check the header and that every section fits before allocating anything
+    SnapshotHeader header{};
+    memcpy(&header, data.data(), sizeof(header));
+    if (!snapshotHeaderValid(header, data.size())) {
+        return nullopt;
+    }
+    // Make a table with the saved capacity
+    HashTable ht(header.capacity);
+    ht.filled = header.filled;
+    // Restore the offsets exactly so the probe sequence matches
+    for (size_t i = 0; i < ht.offsets.size(); i++) {
+        uint64_t stored;
+        memcpy(&stored, data.data() + header.offsetsPos + i * sizeof(uint64_t), sizeof(stored));
+        ht.offsets[i] = stored;
+    }
+    // Restore every bucket in place
+    uint64_t full = 0;
+    for (size_t i = 0; i < ht.table.size(); i++) {
+        SnapshotBucket record{};
+        memcpy(&record, data.data() + header.bucketsPos + i * sizeof(SnapshotBucket), sizeof(record));
+        // Make sure the state is real and the key actually lives inside the file
+        if (!snapshotRecordValid(header, record, data.size())) {
+            return nullopt;
+        }
+        if (record.type == static_cast<uint8_t>(bucketType::NORMAL)) {
+            full++;
+            ht.table[i].load(data.substr(header.keysPos + record.keyOffset, record.keyLength), record.value);
+            ht.table[i].expiry = localExpiry(record.expiresAt);
+            ht.addExpiry(ht.table[i].expiry);
+            ht.usedBytes += entryBytes(ht.table[i].bucketKey);
+        }
+        ht.table[i].type = static_cast<bucketType>(record.type);
+    }
+    // The header's count has to match what's actually in the buckets
+    if (full != header.filled) {
+        return nullopt;
+    }
+    return ht;
 }
 
 /**
-* A parameterized constructor could initialize the key and value, as
-* well as set the bucket type to NORMAL.
+* freeze builds a read-only FrozenHashTable holding every key-value pair in the table. The frozen
+* table uses a minimal perfect hash, so it has no empty slots and every lookup is a single slot.
 */
 
-HashTableBucket::HashTableBucket(const std::string& key, const size_t& value) {
-    // Sets the key
-    bucketKey = key;
-    // Sets the value
-    bucketValue = value;
-    // Sets the type to normal
-    type = bucketType::NORMAL;
+FrozenHashTable HashTable::freeze() const {
+    return FrozenHashTable(*this);
 }
 
 /**
-* A load method could load the key-value pair into the bucket, which
-* should then also mark the bucket as NORMAL.
+* begin and end give forward iterators over every key-value pair in the table, in bucket order.
+* Empty buckets are skipped. Inserting, removing or resizing invalidates the iterators.
 */
 
-void HashTableBucket::load(const std::string& key, const size_t& value) {
-    // Sets the key
-    bucketKey = key;
-    // Sets the value
-    bucketValue = value;
-    // Sets the type to normal
-    type = bucketType::NORMAL;
+HashTable::iterator HashTable::begin() {
+    return iterator(table.data(), 0, table.size());
+}
+
+HashTable::iterator HashTable::end() {
+    return iterator(table.data(), table.size(), table.size());
+}
+
+HashTable::const_iterator HashTable::begin() const {
+    return const_iterator(table.data(), 0, table.size());
+}
+
+HashTable::const_iterator HashTable::end() const {
+    return const_iterator(table.data(), table.size(), table.size());
 }
 
 /**
-* This method would return whether the bucket is empty, regardless of
-* if it has had data placed in it or not.
+* parallelParts returns how many ranges parallelRanges will split the buckets into when asked
+* for this many threads. If threads is 0 the hardware thread count is used, and small tables are
+* never split so tiny scans don't pay for starting threads.
 */
 
-bool HashTableBucket::isEmpty() const {
-    // If the type is not normal then its either ESS or EAR, both of which are empty
-    if (type != bucketType::NORMAL) {
-        // It's empty
-        return true;
+size_t HashTable::parallelParts(size_t threads) const {
+    // Default to one thread per core
+    if (threads == 0) {
+        threads = std::max<size_t>(1, thread::hardware_concurrency());
     }
-    // Its normal, so not empty
-    return false;
-}
\ No newline at end of file
+    // Don't hand a thread fewer than this many buckets
+    constexpr size_t MIN_BUCKETS_PER_THREAD = 4096;
+    return std::min(threads, std::max<size_t>(1, table.size() / MIN_BUCKETS_PER_THREAD));
+}
+
+/**
+* parallelRanges splits the buckets into contiguous ranges and runs work(first, last, part) on
+* each range in its own thread, then waits for all of them. part numbers the ranges from 0.
+*/
+
+void HashTable::parallelRanges(size_t threads, const function<void(size_t, size_t, size_t)>& work) const {
+    // Work out how many ranges to use
+    threads = parallelParts(threads);
+    // One thread just does the whole table itself
+    if (threads == 1) {
+        work(0, table.size(), 0);
+        return;
+    }
+    // Start a thread per range, the last range picks up the leftover buckets
+    size_t chunk = table.size() / threads;
+    vector<thread> workers;
+    workers.reserve(threads);
+    for (size_t part = 0; part < threads; part++) {
+        size_t first = part * chunk;
+        size_t last = (part == threads - 1) ? table.size() : first + chunk;
+        workers.emplace_back(work, first, last, part);
+    }
+    // Wait for every range to finish
+    for (thread& worker : workers) {
+        worker.join();
+    }
+}
+
+/**
+* purge rebuilds the table at the same capacity with no EAR buckets left in it. Removing leaves
+* tombstones behind that every probe still has to walk past, so after lots of removals this
+* makes misses stop early again. Keys are moved, not copied.
+*/
+
+void HashTable::purge() {
+    // Same capacity, same offsets, no tombstones
+    rebuild(max);
+}
+
+/**
+* rebuild moves every live pair into a fresh set of newCap buckets. If the capacity changes the
+* offsets are shuffled again. Hot keys go in first so they land at or near their home bucket, and
+* expired keys are dropped. Keys are moved, not copied, and the size, byte count, filter and
+* CLOCK hand all start over from what's actually left.
+*/
+
+void HashTable::rebuild(size_t newCap) {
+    // Take the old buckets and start over with all ESS buckets
+    BucketVector oldTable = std::move(table);
+    table = BucketVector(newCap, HugePageAllocator<HashTableBucket>(pageMode));
+    if (newCap != max) {
+        max = newCap;
+        shuffleOffsets(max);
+    }
+    filled = 0;
+    usedBytes = 0;
+    clockHand = 0;
+    evictedSincePurge = 0;
+    expiryCounts.clear();
+    // Moves one old bucket into the first open spot on its probe sequence
+    auto moveIn = [this](HashTableBucket& bucket) -> size_t {
+        size_t hole = emptySlot(bucket.bucketKey);
+        usedBytes += entryBytes(bucket.bucketKey);
+        addExpiry(bucket.expiry);
+        table[hole].takeFrom(bucket);
+        filled++;
+        // Already moved, so it's skipped from here on
+        bucket.type = bucketType::EAR;
+        return hole;
+    };
+    // Hot keys go back in first
+    for (HotCacheLine& line : hotCache) {
+        if (line.hits == 0 || line.bucket >= oldTable.size() || oldTable[line.bucket].isEmpty()
+            || isExpired(oldTable[line.bucket])) {
+            continue;
+        }
+        line.bucket = moveIn(oldTable[line.bucket]);
+    }
+    // Then everything else that hasn't expired
+    for (HashTableBucket& bucket : oldTable) {
+        if (bucket.isEmpty()) {
+            continue;
+        }
+        if (isExpired(bucket)) {
+            counters.expirations++;
+            continue;
+        }
+        moveIn(bucket);
+    }
+    // Removed keys are still set in the filter, so this is a good time to drop them
+    if (filter.enabled()) {
+        rebuildFilter();
+    }
+    // Every bucket number changed
+    if (orderEnabled) {
+        rebuildOrder();
+    }
+}
+
+/**
+* emptySlot returns the first empty bucket on the key's probe sequence, which is where insert
+* would put it. The table must have at least one empty bucket.
+*/
+
+size_t HashTable::emptySlot(const std::string& key) const {
+    // Hash the key
+    size_t home = hasher(key) % max;
+    // If the home index is open
+    if (table[home].isEmpty()) {
+        return home;
+    }
+    // Probe until an open bucket turns up
+    for (size_t i = 0; i + 1 < max; i++) {
+        size_t hole = probe(home, static_cast<int>(i));
+        if (table[hole].isEmpty()) {
+            return hole;
+        }
+    }
+    // A full table has no open bucket, hand back the home index
+    return home;
+}
+
+/**
+* locate walks the key's probe sequence once and returns the index of the bucket holding the key,
+* or max if the key isn't in the table. The walk stops at the first ESS bucket, since the key
+* would have been put there or earlier. If firstEmpty isn't null it gets the first empty bucket
+* passed along the way (max if there wasn't one), which is where the key would be inserted. The
+* second version takes the key's hash, for callers that already worked it out.
+*/
+
+size_t HashTable::locate(const std::string& key, size_t* firstEmpty) const {
+    return locate(key, hasher(key), firstEmpty);
+}
+
+size_t HashTable::locate(const std::string& key, size_t hash, size_t* firstEmpty) const {
+    // Nothing empty seen yet
+    if (firstEmpty != nullptr) {
+        *firstEmpty = max;
+    }
+    size_t home = hash % max;
+    // A hot key can be answered straight from the front cache
+    HotCacheLine* line = nullptr;
+    if (!hotCache.empty()) {
+        line = &hotCache[hash & (hotCache.size() - 1)];
+        // Other readers may be updating the line, so read each field once, atomically
+        size_t cached = atomic_ref<size_t>(line->bucket).load(memory_order_relaxed);
+        if (atomic_ref<size_t>(line->hash).load(memory_order_relaxed) == hash && cached < max
+            && table[cached].type == bucketType::NORMAL && table[cached].bucketKey == key) {
+            recordHot(*line, hash, cached);
+            markUsed(table[cached]);
+            return cached;
+        }
+    }
+    // If the filter says the key was never inserted, skip the search
+    if (!filter.mayContain(hash)) {
+        // An insert still needs the first open bucket, which is never far
+        if (firstEmpty != nullptr) {
+            for (size_t i = 0; i < max; i++) {
+                size_t hole = (i == 0) ? home : probe(home, static_cast<int>(i - 1));
+                if (table[hole].isEmpty()) {
+                    *firstEmpty = hole;
+                    break;
+                }
+            }
+        }
+        return max;
+    }
+    // Check the home index and then every probed index
+    for (size_t i = 0; i < max; i++) {
+        size_t hole = (i == 0) ? home : probe(home, static_cast<int>(i - 1));
+        const HashTableBucket& bucket = table[hole];
+        // If the key is at this index
+        if (bucket.type == bucketType::NORMAL) {
+            if (bucket.bucketKey == key) {
+                // Tell the CLOCK sweep this key was used
+                markUsed(bucket);
+                // Keys found off their home bucket compete for the front cache
+                if (line != nullptr && i > 0) {
+                    recordHot(*line, hash, hole);
+                }
+                return hole;
+            }
+            continue;
+        }
+        // Remember the first empty bucket for inserting
+        if (firstEmpty != nullptr && *firstEmpty == max) {
+            *firstEmpty = hole;
+        }
+        // If ESS, stop trying
+        if (bucket.type == bucketType::ESS) {
+            return max;
+        }
+    }
+    // The key was not in the table
+    return max;
+}
+
+/**
+* markUsed sets a bucket's CLOCK reference bit after a hit. Only a bounded table ever evicts, so
+* the bit is left alone otherwise, and it's only written when it isn't already set so repeated
+* hits don't keep dirtying the bucket's cache line. Const lookups can run on several threads at
+* once, so the bit is read and written as a relaxed atomic.
+*/
+
+void HashTable::markUsed(const HashTableBucket& bucket) const {
+    if (maxEntries == 0 && maxBytes == 0) {
+        return;
+    }
+    atomic_ref<uint8_t> referenced(bucket.referenced);
+    if (referenced.load(memory_order_relaxed) == 0) {
+        referenced.store(1, memory_order_relaxed);
+    }
+}
+
+/**
+* recordHot counts a hit for a key that had to be probed for. A key already in the cache line
+* gets its count raised. A different key wears the current one's count down and only takes the
+* line over once it reaches 0, so the line ends up holding whichever key is looked up most.
+* Concurrent const lookups can share a line, so every field is a relaxed atomic access. Racing
+* updates can lose a count or leave a line torn between two keys, which only costs a cache miss
+* since the cached bucket's key is always compared.
+*/
+
+void HashTable::recordHot(HotCacheLine& line, size_t hash, size_t bucket) {
+    atomic_ref<size_t> lineHash(line.hash);
+    atomic_ref<size_t> lineBucket(line.bucket);
+    atomic_ref<uint32_t> lineHits(line.hits);
+    uint32_t hits = lineHits.load(memory_order_relaxed);
+    if (lineHash.load(memory_order_relaxed) == hash) {
+        // Already cached, only write what changed
+        if (lineBucket.load(memory_order_relaxed) != bucket) {
+            lineBucket.store(bucket, memory_order_relaxed);
+        }
+        if (hits < UINT32_MAX) {
+            lineHits.store(hits + 1, memory_order_relaxed);
+        }
+    } else if (hits == 0) {
+        lineHash.store(hash, memory_order_relaxed);
+        lineBucket.store(bucket, memory_order_relaxed);
+        lineHits.store(1, memory_order_relaxed);
+    } else {
+        lineHits.store(hits - 1, memory_order_relaxed);
+    }
+}
+
+/**
+* claim finds the key's bucket, or marks the bucket it should go in as NORMAL and counts it, in a
+* single probe. It returns the bucket index and whether the bucket was just claimed. A claimed
+* bucket still needs its key and value filled in by the caller. The table grows first if it's
+* at least half full, the same as insert always has.
+*/
+
+pair<size_t, bool> HashTable::claim(const std::string& key) {
+    // Look for the key and the first open bucket in one walk
+    size_t open;
+    size_t hole = locate(key, &open);
+    if (hole != max) {
+        // The key is already there
+        if (!isExpired(table[hole])) {
+            return {hole, false};
+        }
+        // It expired, so it's reused as if it were new
+        counters.expirations++;
+        dropExpiry(table[hole].expiry);
+        table[hole].expiry = 0;
+        table[hole].referenced = 0;
+        return {hole, true};
+    }
+    // A bounded table evicts to stay under its limits instead of growing
+    bool moved = (maxEntries > 0 || maxBytes > 0) && makeRoom(entryBytes(key));
+    // If the table is half full it gets expanded
+    if (alpha() >= 0.5) {
+        resizeTable();
+        moved = true;
+    }
+    // Evicting or resizing can change where the open bucket is
+    if (moved) {
+        open = emptySlot(key);
+    }
+    // Mark the bucket as taken
+    table[open].type = bucketType::NORMAL;
+    table[open].referenced = 0;
+    table[open].expiry = 0;
+    // Let the filter know the key is here now
+    if (filter.enabled()) {
+        filter.add(hasher(key));
+    }
+    // The key isn't in the bucket yet, so the ordered index sorts it in later
+    if (orderEnabled) {
+        orderAdd(open);
+    }
+    // Increase size counter
+    filled++;
+    usedBytes += entryBytes(key);
+    return {open, true};
+}
+
+/**
+* find returns an iterator to the key's pair, or end() if the key isn't in the table.
+*/
+
+HashTable::iterator HashTable::find(const std::string& key) {
+    return iterator(table.data(), locateLive(key), table.size());
+}
+
+HashTable::const_iterator HashTable::find(const std::string& key) const {
+    return const_iterator(table.data(), locateLive(key), table.size());
+}
+
+/**
+* try_emplace inserts the pair only if the key isn't already in the table, and leaves an existing
+* value alone. Either way it returns an iterator to the key's pair and whether it was inserted.
+* The duplicate check and the insert share one probe. The rvalue version moves the key in.
+*/
+
+pair<HashTable::iterator, bool> HashTable::try_emplace(const std::string& key, const size_t& value) {
+    auto [hole, inserted] = claim(key);
+    // Fill in a newly claimed bucket
+    if (inserted) {
+        table[hole].bucketKey = key;
+        table[hole].bucketValue = value;
+    }
+    return {iterator(table.data(), hole, table.size()), inserted};
+}
+
+pair<HashTable::iterator, bool> HashTable::try_emplace(std::string&& key, const size_t& value) {
+    auto [hole, inserted] = claim(key);
+    // Fill in a newly claimed bucket
+    if (inserted) {
+        table[hole].bucketKey = std::move(key);
+        table[hole].bucketValue = value;
+    }
+    return {iterator(table.data(), hole, table.size()), inserted};
+}
+
+/**
+* insert_or_assign inserts the pair if the key is new, or overwrites the value if it isn't. It
+* returns an iterator to the key's pair and whether it was inserted, in one probe.
+*/
+
+pair<HashTable::iterator, bool> HashTable::insert_or_assign(const std::string& key, const size_t& value) {
+    auto [hole, inserted] = claim(key);
+    // Only a new bucket needs the key
+    if (inserted) {
+        table[hole].bucketKey = key;
+    }
+    // The value is set either way
+    table[hole].bucketValue = value;
+    return {iterator(table.data(), hole, table.size()), inserted};
+}
+
+/**
+* resolveConflict decides what happens to an existing value when a merge brings in the same key.
+*/
+
+void HashTable::resolveConflict(size_t& existing, size_t incoming, MergePolicy policy) {
+    switch (policy) {
+        case MergePolicy::KEEP_EXISTING:
+            break;
+        case MergePolicy::TAKE_INCOMING:
+            existing = incoming;
+            break;
+        case MergePolicy::SUM:
+            existing += incoming;
+            break;
+    }
+}
+
+/**
+* merge moves every pair out of other and into this table, one probe per key. Keys that are new
+* here have their strings moved, not copied. Keys that are already here are settled by policy.
+* The table is grown once up front, so nothing resizes partway through. other is left empty, and
+* merging a table into itself does nothing. Returns how many new keys were added.
+*/
+
+size_t HashTable::merge(HashTable&& other, MergePolicy policy) {
+    // Merging a table into itself changes nothing
+    if (&other == this) {
+        return 0;
+    }
+    // Grow, in one rebuild, enough for every incoming key to be new without going over half full
+    size_t cap = capacityFor(filled + other.filled, max);
+    if (cap != max) {
+        rebuild(cap);
+    }
+    size_t added = 0;
+    for (HashTableBucket& bucket : other.table) {
+        if (bucket.isEmpty() || isExpired(bucket)) {
+            continue;
+        }
+        auto [hole, inserted] = claim(bucket.bucketKey);
+        if (inserted) {
+            // Take the key's string instead of copying it
+            table[hole].takeFrom(bucket);
+            addExpiry(table[hole].expiry);
+            added++;
+        } else {
+            resolveConflict(table[hole].bucketValue, bucket.bucketValue, policy);
+        }
+    }
+    // Leave other as a fresh empty table
+    other = HashTable();
+    return added;
+}
+
+/**
+* capacityFor returns the smallest capacity, doubling up from cap, that holds count pairs and one
+* more insert while staying under half full, the same point insert grows at.
+*/
+
+size_t HashTable::capacityFor(size_t count, size_t cap) {
+    while (static_cast<double>(count + 1) / static_cast<double>(cap) >= 0.5) {
+        cap *= 2;
+    }
+    return cap;
+}
+
+/**
+* mergeAll combines many tables, usually one per worker thread, into one. Keys are split into
+* hash ranges and each range gets a thread that pulls only its own keys out of every part and
+* settles duplicates, so no two threads ever touch the same key. The finished ranges can't share
+* keys, so they're moved into the result without any duplicate checks. That last move runs on one
+* thread, since a range of hashes can land anywhere in the result's buckets. Each range's table
+* is sized up front for its share of the keys. The parts are left empty.
+*/
+
+HashTable HashTable::mergeAll(vector<HashTable>&& parts, MergePolicy policy, size_t threads) {
+    // Default to one thread per core
+    if (threads == 0) {
+        threads = std::max<size_t>(1, thread::hardware_concurrency());
+    }
+    threads = std::min<size_t>(threads, 0xFFFF);
+    // Which range each key belongs to comes from the top bits of its hash
+    auto rangeOf = [threads](size_t hash) {
+        return static_cast<uint16_t>(((static_cast<uint64_t>(hash) >> 32) * threads) >> 32);
+    };
+    // Work out every bucket's range once, in parallel, instead of having every thread hash
+    // every key
+    vector<vector<uint16_t>> ranges(parts.size());
+    for (size_t p = 0; p < parts.size(); p++) {
+        HashTable& part = parts[p];
+        ranges[p].resize(part.table.size());
+        part.parallelRanges(threads, [&part, &ranges, &rangeOf, p](size_t first, size_t last, size_t) {
+            for (size_t i = first; i < last; i++) {
+                if (!part.table[i].isEmpty()) {
+                    ranges[p][i] = rangeOf(part.hasher(part.table[i].bucketKey));
+                }
+            }
+        });
+    }
+    // Each thread builds the table for its own hash range, sized for an even share of the keys
+    size_t incoming = 0;
+    for (HashTable& part : parts) {
+        incoming += part.size();
+    }
+    size_t share = capacityFor((incoming + threads - 1) / threads);
+    vector<HashTable> pieces;
+    pieces.reserve(threads);
+    for (size_t r = 0; r < threads; r++) {
+        pieces.emplace_back(share);
+    }
+    vector<thread> workers;
+    workers.reserve(threads);
+    for (size_t r = 0; r < threads; r++) {
+        workers.emplace_back([&parts, &ranges, &pieces, policy, r]() {
+            HashTable& piece = pieces[r];
+            for (size_t p = 0; p < parts.size(); p++) {
+                BucketVector& source = parts[p].table;
+                for (size_t i = 0; i < source.size(); i++) {
+                    if (source[i].isEmpty() || ranges[p][i] != r || isExpired(source[i])) {
+                        continue;
+                    }
+                    auto [hole, inserted] = piece.claim(source[i].bucketKey);
+                    if (inserted) {
+                        piece.table[hole].takeFrom(source[i]);
+                    } else {
+                        resolveConflict(piece.table[hole].bucketValue, source[i].bucketValue, policy);
+                    }
+                }
+            }
+        });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+    // Size the result for everything at once
+    size_t total = 0;
+    for (HashTable& piece : pieces) {
+        total += piece.filled;
+    }
+    HashTable result(capacityFor(total));
+    // The ranges never share a key, so every pair just goes in the first open bucket
+    for (HashTable& piece : pieces) {
+        for (HashTableBucket& bucket : piece.table) {
+            if (!bucket.isEmpty()) {
+                result.usedBytes += entryBytes(bucket.bucketKey);
+                result.addExpiry(bucket.expiry);
+                result.table[result.emptySlot(bucket.bucketKey)].takeFrom(bucket);
+            }
+        }
+    }
+    result.filled = total;
+    // Leave the parts empty
+    for (HashTable& part : parts) {
+        part = HashTable();
+    }
+    return result;
+}
+
+/**
+* enableFilter puts a Bloom filter in front of the buckets, sized for a half full table at
+* bitsPerKey bits per key (10 gives about 1% false positives). After that, looking up a key that
+* was never inserted usually stops at the filter instead of walking the probe sequence. A Bloom
+* filter can't forget keys, so removed keys stay in it until the next resize or purge rebuilds it.
+*/
+
+void HashTable::enableFilter(size_t bitsPerKey) {
+    filterBitsPerKey = std::max<size_t>(bitsPerKey, 1);
+    rebuildFilter();
+}
+
+/**
+* disableFilter turns the filter off and frees it.
+*/
+
+void HashTable::disableFilter() {
+    filter.clear();
+    filterBitsPerKey = 0;
+}
+
+/**
+* rebuildFilter sizes the filter for the current capacity and adds every key that's in the table
+* right now, which clears out the bits left behind by removed keys.
+*/
+
+void HashTable::rebuildFilter() {
+    // Nothing to rebuild if the filter is off
+    if (filterBitsPerKey == 0) {
+        return;
+    }
+    filter.reset(max / 2 + 1, filterBitsPerKey);
+    for (auto it = begin(); it != end(); ++it) {
+        filter.add(hasher(it.key()));
+    }
+}
+
+/**
+* enableHotCache puts a small direct-mapped cache in front of the buckets, with lines rounded up
+* to a power of two. Each line remembers the bucket of whichever key that maps to it is looked up
+* most, so with skewed traffic the hottest keys are found in one step even when they sit deep in
+* a probe sequence. Lookups update the cache through relaxed atomics, so const lookups (get,
+* contains, find) can still run on several threads at once, at worst losing a hit count. Anything
+* that changes the table, relocateHot included, needs the table to itself as always. A stale line
+* is harmless, the key is always compared.
+*/
+
+void HashTable::enableHotCache(size_t lines) {
+    size_t count = 1;
+    while (count < lines) {
+        count *= 2;
+    }
+    hotCache.assign(count, HotCacheLine{0, 0, 0});
+}
+
+/**
+* disableHotCache turns the hot cache off and frees it.
+*/
+
+void HashTable::disableHotCache() {
+    hotCache.clear();
+    hotCache.shrink_to_fit();
+}
+
+/**
+* relocateHot moves every key held in the hot cache to the first EAR bucket on its probe sequence
+* that comes before where it is now, so it's found sooner even without the cache. Only
+* tombstones are used, since moving a key into another key's bucket would break that key's probe.
+* Returns how many keys moved. Moving keys invalidates iterators.
+*/
+
+size_t HashTable::relocateHot() {
+    size_t moved = 0;
+    for (HotCacheLine& line : hotCache) {
+        // Skip lines that don't point at a full bucket any more
+        if (line.hits == 0 || line.bucket >= max || table[line.bucket].isEmpty()) {
+            continue;
+        }
+        HashTableBucket& current = table[line.bucket];
+        size_t home = hasher(current.bucketKey) % max;
+        // Walk the probe sequence up to the key's bucket looking for a tombstone
+        for (size_t i = 0; i < max; i++) {
+            size_t hole = (i == 0) ? home : probe(home, static_cast<int>(i - 1));
+            if (hole == line.bucket) {
+                break;
+            }
+            if (table[hole].type == bucketType::EAR) {
+                // Move the key up and leave a tombstone where it was
+                if (orderEnabled) {
+                    orderMove(line.bucket, hole);
+                }
+                table[hole].takeFrom(current);
+                current.load("", 0);
+                current.type = bucketType::EAR;
+                line.bucket = hole;
+                moved++;
+                break;
+            }
+        }
+    }
+    return moved;
+}
+
+/**
+* setCapacityLimit turns on bounded mode. Once the table holds entries pairs, or its pairs take
+* more than bytes bytes (counted as the bucket plus the key's characters), insert evicts with a
+* CLOCK sweep instead of growing: the sweep skips over recently used keys once, clearing their
+* reference bit, and evicts the first key it finds that hasn't been used since its last pass.
+* Expired keys are always evicted first. 0 means no limit, so setCapacityLimit(0, 0) turns
+* bounded mode back off. The reference bit lives in padding inside the bucket, so this costs no
+* extra memory per key.
+*/
+
+void HashTable::setCapacityLimit(size_t entries, size_t bytes) {
+    maxEntries = entries;
+    maxBytes = bytes;
+    // Get under the new limits right away
+    if (maxEntries > 0 || maxBytes > 0) {
+        trimToLimit();
+    }
+}
+
+/**
+* expireAfter makes the key expire the given number of seconds from now. An expired key acts like
+* it was removed: get, contains, find and operator[] stop seeing it, and it's cleared out by the
+* next eviction sweep, purge, resize or insert of the same key. A time past the end of the clock
+* is held at the last second it can show, so a huge TTL never wraps around into the past. Returns
+* false if the key isn't in the table.
+*/
+
+bool HashTable::expireAfter(const std::string& key, uint32_t seconds) {
+    size_t hole = locateLive(key);
+    // The key was not in the table
+    if (hole == max) {
+        return false;
+    }
+    uint64_t at = static_cast<uint64_t>(nowSeconds()) + seconds;
+    dropExpiry(table[hole].expiry);
+    table[hole].expiry = static_cast<uint32_t>(std::min<uint64_t>(at, UINT32_MAX));
+    addExpiry(table[hole].expiry);
+    return true;
+}
+
+/**
+* locateLive is locate for lookups: an expired key counts as not being in the table. The second
+* version takes the key's hash, for callers that already worked it out.
+*/
+
+size_t HashTable::locateLive(const std::string& key) const {
+    return locateLive(key, hasher(key));
+}
+
+size_t HashTable::locateLive(const std::string& key, size_t hash) const {
+    size_t hole = locate(key, hash);
+    if (hole != max && isExpired(table[hole])) {
+        return max;
+    }
+    return hole;
+}
+
+/**
+* evictOne advances the CLOCK hand until it finds a key to evict and turns its bucket into a
+* tombstone. Returns false if there was nothing to evict.
+*/
+
+bool HashTable::evictOne() {
+    // Two passes is always enough, the first clears every reference bit it passes
+    for (size_t step = 0; step < 2 * max + 1 && filled > 0; step++) {
+        HashTableBucket& bucket = table[clockHand];
+        clockHand = (clockHand + 1) % max;
+        if (bucket.type != bucketType::NORMAL) {
+            continue;
+        }
+        if (isExpired(bucket)) {
+            counters.expirations++;
+        } else if (bucket.referenced) {
+            // Used since the last pass, so it gets another chance
+            bucket.referenced = 0;
+            continue;
+        } else {
+            counters.evictions++;
+        }
+        // Same thing remove does to a bucket
+        usedBytes -= entryBytes(bucket.bucketKey);
+        dropExpiry(bucket.expiry);
+        if (orderEnabled) {
+            orderErase(&bucket - table.data());
+        }
+        bucket.load("", 0);
+        bucket.type = bucketType::EAR;
+        filled--;
+        evictedSincePurge++;
+        return true;
+    }
+    return false;
+}
+
+/**
+* makeRoom evicts until one more pair of need bytes fits under the limits. If evictions have left
+* lots of tombstones behind it purges them. Returns true if anything was evicted, since the
+* buckets may have moved.
+*/
+
+bool HashTable::makeRoom(size_t need) {
+    bool evicted = false;
+    while ((maxEntries > 0 && filled >= maxEntries) || (maxBytes > 0 && usedBytes + need > maxBytes)) {
+        if (!evictOne()) {
+            break;
+        }
+        evicted = true;
+    }
+    // Too many tombstones make every miss slow
+    if (evictedSincePurge > max / 4) {
+        purge();
+    }
+    return evicted;
+}
+
+/**
+* trimToLimit evicts until the table is within its limits, without leaving room for another pair,
+* so a table already holding exactly the limit keeps everything. Used when the limits change.
+* Returns true if anything was evicted.
+*/
+
+bool HashTable::trimToLimit() {
+    bool evicted = false;
+    while ((maxEntries > 0 && filled > maxEntries) || (maxBytes > 0 && usedBytes > maxBytes)) {
+        if (!evictOne()) {
+            break;
+        }
+        evicted = true;
+    }
+    if (evictedSincePurge > max / 4) {
+        purge();
+    }
+    return evicted;
+}
+
+/**
+* stats returns how many keys have been evicted and how many have expired.
+*/
+
+HashTableStats HashTable::stats() const {
+    HashTableStats current = counters;
+    current.bucketBacking = pageBackingOf(table.data());
+    current.offsetBacking = pageBackingOf(offsets.data());
+    return current;
+}
+
+/**
+* nowSeconds returns the seconds since the program started, plus 1 so a real expiry is never 0.
+* Every table uses the same clock, so expiry times can move between tables as they are.
+*/
+
+uint32_t HashTable::nowSeconds() {
+    static const auto start = chrono::steady_clock::now();
+    auto elapsed = chrono::duration_cast<chrono::seconds>(chrono::steady_clock::now() - start);
+    return static_cast<uint32_t>(elapsed.count()) + 1;
+}
+
+/**
+* wallSeconds returns the wall clock time in seconds since the Unix epoch. Expiry times are kept
+* on nowSeconds's clock, which starts over with every process, so anything written to disk uses
+* this one instead.
+*/
+
+uint64_t HashTable::wallSeconds() {
+    auto since = chrono::system_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::seconds>(since).count());
+}
+
+/**
+* wallExpiry turns an expiry time on nowSeconds's clock into wall clock seconds, for writing out.
+* 0 (no expiry) stays 0.
+*/
+
+uint64_t HashTable::wallExpiry(uint32_t expiry) {
+    if (expiry == 0) {
+        return 0;
+    }
+    // Whatever is left of the TTL, counted from the wall clock's now
+    uint32_t now = nowSeconds();
+    return wallSeconds() + (expiry > now ? expiry - now : 0);
+}
+
+/**
+* localExpiry turns wall clock seconds written by wallExpiry back into an expiry time on
+* nowSeconds's clock. A time that has already passed comes back as now, so the key is expired,
+* and 0 (no expiry) stays 0.
+*/
+
+uint32_t HashTable::localExpiry(uint64_t wall) {
+    if (wall == 0) {
+        return 0;
+    }
+    uint64_t wallNow = wallSeconds();
+    uint64_t left = wall > wallNow ? wall - wallNow : 0;
+    return static_cast<uint32_t>(std::min<uint64_t>(nowSeconds() + left, UINT32_MAX));
+}
+
+/**
+* isExpired returns whether a full bucket has an expiry time that has passed. The clock is only
+* read for buckets that have an expiry at all.
+*/
+
+bool HashTable::isExpired(const HashTableBucket& bucket) {
+    return bucket.expiry != 0 && nowSeconds() >= bucket.expiry;
+}
+
+/**
+* addExpiry counts one more full bucket with the given expiry time. 0 means no expiry and isn't
+* counted.
+*/
+
+void HashTable::addExpiry(uint32_t expiry) {
+    if (expiry != 0) {
+        expiryCounts[expiry]++;
+    }
+}
+
+/**
+* dropExpiry counts one less full bucket with the given expiry time, when that bucket is emptied
+* or given a new time.
+*/
+
+void HashTable::dropExpiry(uint32_t expiry) {
+    if (expiry == 0) {
+        return;
+    }
+    auto it = expiryCounts.find(expiry);
+    if (it != expiryCounts.end() && --it->second == 0) {
+        expiryCounts.erase(it);
+    }
+}
+
+/**
+* expiredCount returns how many full buckets hold keys that have expired but haven't been reaped.
+* The counts are kept by expiry time, so only the times that have already passed are added up.
+*/
+
+size_t HashTable::expiredCount() const {
+    if (expiryCounts.empty()) {
+        return 0;
+    }
+    size_t expired = 0;
+    auto last = expiryCounts.upper_bound(nowSeconds());
+    for (auto it = expiryCounts.begin(); it != last; ++it) {
+        expired += it->second;
+    }
+    return expired;
+}
+
+/**
+* entryBytes is what one pair counts for against the byte limit: its bucket plus its key.
+*/
+
+size_t HashTable::entryBytes(const std::string& key) {
+    return sizeof(HashTableBucket) + key.size();
+}
+
+/**
+* enableOrderedIndex keeps a second, sorted view of the keys next to the hash table so range and
+* prefix can walk keys in order without copying or sorting them. The index is just the bucket
+* numbers of the keys sorted by key, split into sorted chunks of at most ORDER_CHUNK_MAX, so it
+* costs about 8 bytes per key and a remove only shifts the numbers in one chunk. Point lookups
+* never touch it. New keys are added to a small unsorted batch that's sorted in the next time the
+* index is read, so inserting stays cheap.
+*/
+
+void HashTable::enableOrderedIndex() {
+    orderEnabled = true;
+    rebuildOrder();
+}
+
+/**
+* disableOrderedIndex drops the ordered index and its memory.
+*/
+
+void HashTable::disableOrderedIndex() {
+    orderEnabled = false;
+    vector<vector<size_t>>().swap(orderChunks);
+    vector<size_t>().swap(orderPending);
+}
+
+/**
+* range returns iterators to every pair with lo <= key < hi, in key order. Nothing is copied,
+* the iterators point straight at the buckets and stay good until the table is changed. Throws an
+* exception if the ordered index isn't enabled.
+*/
+
+vector<HashTable::const_iterator> HashTable::range(const std::string& lo, const std::string& hi) const {
+    // There's no order to read without the index
+    if (!orderEnabled) {
+        throw exception();
+    }
+    flushOrder();
+    vector<const_iterator> result;
+    // Start at the first key that isn't less than lo and walk across chunks until hi
+    for (size_t c = orderChunkFor(lo); c < orderChunks.size(); c++) {
+        const vector<size_t>& chunk = orderChunks[c];
+        auto it = lower_bound(chunk.begin(), chunk.end(), lo, [this](size_t bucket, const string& key) {
+            return table[bucket].bucketKey < key;
+        });
+        for (; it != chunk.end(); ++it) {
+            if (!(table[*it].bucketKey < hi)) {
+                return result;
+            }
+            // Expired keys stay in the index until they're cleared out
+            if (!isExpired(table[*it])) {
+                result.emplace_back(table.data(), *it, table.size());
+            }
+        }
+    }
+    return result;
+}
+
+/**
+* prefix returns iterators to every pair whose key starts with p, in key order. Throws an
+* exception if the ordered index isn't enabled.
+*/
+
+vector<HashTable::const_iterator> HashTable::prefix(const std::string& p) const {
+    if (!orderEnabled) {
+        throw exception();
+    }
+    flushOrder();
+    vector<const_iterator> result;
+    // Keys starting with p are all together, starting at the first key not less than p
+    for (size_t c = orderChunkFor(p); c < orderChunks.size(); c++) {
+        const vector<size_t>& chunk = orderChunks[c];
+        auto it = lower_bound(chunk.begin(), chunk.end(), p, [this](size_t bucket, const string& key) {
+            return table[bucket].bucketKey < key;
+        });
+        for (; it != chunk.end(); ++it) {
+            if (table[*it].bucketKey.compare(0, p.size(), p) != 0) {
+                return result;
+            }
+            if (!isExpired(table[*it])) {
+                result.emplace_back(table.data(), *it, table.size());
+            }
+        }
+    }
+    return result;
+}
+
+/**
+* orderLess compares two buckets by their keys, for sorting the ordered index.
+*/
+
+bool HashTable::orderLess(size_t a, size_t b) const {
+    return table[a].bucketKey < table[b].bucketKey;
+}
+
+/**
+* orderChunkFor returns the first chunk whose last key isn't less than key, which is the only
+* chunk key could be in, or the number of chunks if every key in the index is less.
+*/
+
+size_t HashTable::orderChunkFor(const std::string& key) const {
+    auto it = lower_bound(orderChunks.begin(), orderChunks.end(), key, [this](const vector<size_t>& chunk, const string& k) {
+        return table[chunk.back()].bucketKey < k;
+    });
+    return static_cast<size_t>(it - orderChunks.begin());
+}
+
+/**
+* orderAdd puts a newly claimed bucket in the unsorted batch. Its key is filled in after claim
+* returns, so it can't be sorted in yet.
+*/
+
+void HashTable::orderAdd(size_t bucket) {
+    orderPending.push_back(bucket);
+}
+
+/**
+* orderInsert sorts one full bucket into its chunk, splitting the chunk in half once it grows past
+* ORDER_CHUNK_MAX.
+*/
+
+void HashTable::orderInsert(size_t bucket) const {
+    if (orderChunks.empty()) {
+        orderChunks.emplace_back(1, bucket);
+        return;
+    }
+    // Past the last chunk's last key goes on the end of the last chunk
+    size_t c = std::min(orderChunkFor(table[bucket].bucketKey), orderChunks.size() - 1);
+    vector<size_t>& chunk = orderChunks[c];
+    auto it = lower_bound(chunk.begin(), chunk.end(), bucket, [this](size_t a, size_t b) { return orderLess(a, b); });
+    chunk.insert(it, bucket);
+    if (chunk.size() > ORDER_CHUNK_MAX) {
+        vector<size_t> upper(chunk.begin() + chunk.size() / 2, chunk.end());
+        chunk.resize(chunk.size() / 2);
+        orderChunks.insert(orderChunks.begin() + c + 1, std::move(upper));
+    }
+}
+
+/**
+* orderErase takes a bucket out of the ordered index. It has to be called before the bucket's key
+* is cleared, since the bucket is found by binary searching for its key. A bucket still waiting in
+* the batch is left there, flushOrder drops it once it sees the bucket is empty.
+*/
+
+void HashTable::orderErase(size_t bucket) {
+    size_t c = orderChunkFor(table[bucket].bucketKey);
+    if (c == orderChunks.size()) {
+        return;
+    }
+    vector<size_t>& chunk = orderChunks[c];
+    auto it = lower_bound(chunk.begin(), chunk.end(), bucket, [this](size_t a, size_t b) { return orderLess(a, b); });
+    if (it != chunk.end() && *it == bucket) {
+        chunk.erase(it);
+        // Every chunk has to have a last key to search by
+        if (chunk.empty()) {
+            orderChunks.erase(orderChunks.begin() + c);
+        }
+    }
+}
+
+/**
+* orderMove points the index at a key's new bucket when the key is moved. Called before the key
+* leaves its old bucket, so the old bucket is taken out now and the new one goes in the batch to
+* be sorted in once the key has arrived.
+*/
+
+void HashTable::orderMove(size_t from, size_t to) {
+    orderErase(from);
+    orderAdd(to);
+}
+
+/**
+* flushOrder sorts the batch of new buckets into the index. A bucket that was removed while it was
+* still in the batch is dropped, and one that was claimed twice is only kept once. A big batch is
+* merged in with one pass over the whole index instead of one insert at a time.
+*/
+
+void HashTable::flushOrder() const {
+    if (orderPending.empty()) {
+        return;
+    }
+    // Drop buckets that were emptied before they made it into the index
+    std::erase_if(orderPending, [this](size_t bucket) { return table[bucket].type != bucketType::NORMAL; });
+    auto less = [this](size_t a, size_t b) { return orderLess(a, b); };
+    sort(orderPending.begin(), orderPending.end(), less);
+    orderPending.erase(unique(orderPending.begin(), orderPending.end()), orderPending.end());
+    size_t indexed = 0;
+    for (const vector<size_t>& chunk : orderChunks) {
+        indexed += chunk.size();
+    }
+    if (orderPending.size() * 8 < indexed) {
+        // A few new keys, each goes into its own chunk
+        for (size_t bucket : orderPending) {
+            orderInsert(bucket);
+        }
+    } else {
+        // Lots of new keys, merge everything and cut it into chunks again
+        vector<size_t> merged;
+        merged.reserve(indexed + orderPending.size());
+        for (const vector<size_t>& chunk : orderChunks) {
+            merged.insert(merged.end(), chunk.begin(), chunk.end());
+        }
+        size_t middle = merged.size();
+        merged.insert(merged.end(), orderPending.begin(), orderPending.end());
+        inplace_merge(merged.begin(), merged.begin() + middle, merged.end(), less);
+        orderLayout(merged);
+    }
+    orderPending.clear();
+}
+
+/**
+* orderLayout cuts a sorted list of buckets into half full chunks, so each can take new keys
+* before it splits.
+*/
+
+void HashTable::orderLayout(const vector<size_t>& sorted) const {
+    orderChunks.clear();
+    for (size_t first = 0; first < sorted.size(); first += ORDER_CHUNK_MAX / 2) {
+        size_t last = std::min(sorted.size(), first + ORDER_CHUNK_MAX / 2);
+        orderChunks.emplace_back(sorted.begin() + first, sorted.begin() + last);
+    }
+}
+
+/**
+* rebuildOrder sorts every full bucket into a new index. Used when buckets have all moved, like
+* after a resize or purge.
+*/
+
+void HashTable::rebuildOrder() {
+    orderPending.clear();
+    vector<size_t> sorted;
+    sorted.reserve(filled);
+    for (size_t i = 0; i < table.size(); i++) {
+        if (table[i].type == bucketType::NORMAL) {
+            sorted.push_back(i);
+        }
+    }
+    sort(sorted.begin(), sorted.end(), [this](size_t a, size_t b) { return orderLess(a, b); });
+    orderLayout(sorted);
+}
+
+/**
+* setPageMode picks what the bucket and offset arrays are allocated from and moves the table into
+* new arrays right away. TRANSPARENT and HUGETLB only apply once an array is at least
+* HUGE_PAGE_MIN_BYTES, and fall back quietly if the system can't give huge pages. stats reports
+* what each array actually got.
+*/
+
+void HashTable::setPageMode(PageMode mode) {
+    pageMode = mode;
+    // Same offsets in new memory, then the same capacity keeps the probe order
+    offsets = OffsetVector(offsets.begin(), offsets.end(), HugePageAllocator<size_t>(pageMode));
+    rebuild(max);
+}
+
+/**
+* shuffleOffsets makes a new shuffled offsets array for newCap buckets, allocated for the
+* current page mode.
+*/
+
+void HashTable::shuffleOffsets(size_t newCap) {
+    vector<size_t> shuffled = offsetShuffle(newCap);
+    offsets = OffsetVector(shuffled.begin(), shuffled.end(), HugePageAllocator<size_t>(pageMode));
+}
+
+/**
+* memory_usage adds up every byte the table holds onto: the bucket array, the probe offsets and
+* the table itself, the key strings too long to fit inside their bucket, the filter, hot cache,
+* ordered index and expiry counts, and whatever is allocated but unused. Key bytes are counted as asked of the
+* allocator, so malloc's own rounding isn't included.
+*/
+
+HashTableMemory HashTable::memory_usage() const {
+    HashTableMemory usage{filled, 0, 0, 0, 0, 0};
+    // The arrays count what they hold, the rest of what the allocator handed out is slack
+    usage.bucketBytes = table.size() * sizeof(HashTableBucket);
+    usage.metadataBytes = offsets.size() * sizeof(size_t) + sizeof(HashTable);
+    usage.slackBytes += pageBytesOf(table.data()) - (table.data() == nullptr ? 0 : usage.bucketBytes);
+    usage.slackBytes += pageBytesOf(offsets.data()) - offsets.size() * sizeof(size_t);
+    // Short keys live inside the bucket's string, longer ones have their own heap buffer
+    const size_t inlineCapacity = std::string().capacity();
+    for (const HashTableBucket& bucket : table) {
+        const std::string& key = bucket.bucketKey;
+        if (key.capacity() <= inlineCapacity) {
+            continue;
+        }
+        // A removed key leaves its buffer behind, which is all slack
+        size_t used = bucket.type == bucketType::NORMAL ? key.size() + 1 : 0;
+        usage.keyBytes += used;
+        usage.slackBytes += key.capacity() + 1 - used;
+    }
+    // Side tables, only there if they've been turned on
+    auto side = [&usage](size_t count, size_t spare, size_t each) {
+        usage.sideTableBytes += count * each;
+        usage.slackBytes += spare * each;
+    };
+    side(filter.blocks.size(), filter.blocks.capacity() - filter.blocks.size(), sizeof(BloomBlock));
+    side(hotCache.size(), hotCache.capacity() - hotCache.size(), sizeof(HotCacheLine));
+    side(orderChunks.size(), orderChunks.capacity() - orderChunks.size(), sizeof(vector<size_t>));
+    for (const vector<size_t>& chunk : orderChunks) {
+        side(chunk.size(), chunk.capacity() - chunk.size(), sizeof(size_t));
+    }
+    side(orderPending.size(), orderPending.capacity() - orderPending.size(), sizeof(size_t));
+    // Each expiry time is a tree node: the pair plus three links and a color
+    side(expiryCounts.size(), 0, sizeof(pair<const uint32_t, size_t>) + 4 * sizeof(void*));
+    return usage;
+}
+
+//BUCKET
+
+/**
+* The default constructor can simply set the bucket type to ESS.
+*/
+
+HashTableBucket::HashTableBucket() {
+    // Sets value to zero
+    bucketValue = 0;
+    // Sets type to Empty Since Start
+    type = bucketType::ESS;
+    // Not used yet and never expires
+    referenced = 0;
+    expiry = 0;
+}
+
+/**
+* A parameterized constructor could initialize the key and value, as
+* well as set the bucket type to NORMAL.
+*/
+
+HashTableBucket::HashTableBucket(const std::string& key, const size_t& value) {
+    // Sets the key
+    bucketKey = key;
+    // Sets the value
+    bucketValue = value;
+    // Sets the type to normal
+    type = bucketType::NORMAL;
+    // Not used yet and never expires
+    referenced = 0;
+    expiry = 0;
+}
+
+/**
+* A load method could load the key-value pair into the bucket, which
+* should then also mark the bucket as NORMAL.
+*/
+
+void HashTableBucket::load(const std::string& key, const size_t& value) {
+    // Sets the key
+    bucketKey = key;
+    // Sets the value
+    bucketValue = value;
+    // Sets the type to normal
+    type = bucketType::NORMAL;
+    // Not used yet and never expires
+    referenced = 0;
+    expiry = 0;
+}
+
+/**
+* This method would return whether the bucket is empty, regardless of
+* if it has had data placed in it or not.
+*/
+
+bool HashTableBucket::isEmpty() const {
+    // If the type is not normal then its either ESS or EAR, both of which are empty
+    if (type != bucketType::NORMAL) {
+        // It's empty
+        return true;
+    }
+    // Its normal, so not empty
+    return false;
+}
+
+/**
+* isLive returns whether the bucket holds a pair that can still be seen: it's full and hasn't
+* expired. Iterating, printing, saving and freezing all skip buckets that aren't live.
+*/
+
+bool HashTableBucket::isLive() const {
+    return type == bucketType::NORMAL && !HashTable::isExpired(*this);
+}
+
+/**
+* takeFrom moves another bucket's pair into this one, key string and expiry included, and marks
+* this bucket NORMAL. The other bucket's key is left empty, its type is up to the caller.
+*/
+
+void HashTableBucket::takeFrom(HashTableBucket& other) {
+    bucketKey = std::move(other.bucketKey);
+    bucketValue = other.bucketValue;
+    expiry = other.expiry;
+    referenced = 0;
+    type = bucketType::NORMAL;
+}
@@ -7,24 +7,93 @@
 * function, the resizeTable the remove function, the contains function, the get function,
 * the [] operator override, the keys function, the alpha function, the capacity function, the size
 * function, the printMe function, the << operator override, the probe function, the offsetShuffle
-* function, the HashTableBucket constructors, the load function, the isEmpty function.
+* function, the saveSnapshot functions, the loadSnapshot function, the freeze function, the begin
+* and end functions, the parallelParts function, the parallelRanges function, the
+* parallel_for_each function, the parallel_reduce function, the erase_if function, the purge
+* function, the emptySlot function, the dump function, the locate functions, the claim function,
+* the find functions, the try_emplace functions, the insert_or_assign function, the upsert
+* function, the update function, the merge function, the mergeAll function, the resolveConflict
+* function, the capacityFor function, the enableFilter function, the disableFilter function,
+* the rebuildFilter function, the recordHot function, the enableHotCache
+* function, the disableHotCache function, the relocateHot function, the setCapacityLimit function,
+* the expireAfter function, the locateLive functions, the markUsed function, the evictOne function,
+* the makeRoom function, the trimToLimit function, the stats function, the nowSeconds function, the
+* wallSeconds function, the wallExpiry function, the localExpiry function, the isExpired function,
+* the addExpiry function, the dropExpiry function, the expiredCount function, the entryBytes
+* function, the rebuild function, the enableOrderedIndex function, the disableOrderedIndex function,
+* the range function, the prefix function, the orderLess function, the orderChunkFor function, the
+* orderAdd function, the orderInsert function, the orderErase function, the orderMove function, the
+* flushOrder function, the orderLayout function, the rebuildOrder function, the setPageMode
+* function, the shuffleOffsets function, the memory_usage function, the HashTableBucket
+* constructors, the load function, the isEmpty function, the isLive function, the takeFrom function,
+* the HashTableIterator class.
 * -----------------------------------------------------------------------------------------*/
 #pragma once
 
+#include "BloomFilter.h"
+#include "HugePageAllocator.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <map>
 #include <optional>
 #include <string>
 #include <ostream>
+#include <utility>
 #include <vector>
 
 using namespace std;
 
+class FrozenHashTable;
+
 // enum types for buckets
-enum class bucketType {NORMAL, ESS, EAR};
+enum class bucketType : uint8_t {NORMAL, ESS, EAR};
+
+// enum types for dump output
+enum class DumpFormat {TEXT, CSV, JSONL};
+
+// Most bucket numbers in one chunk of the ordered index before it splits in two
+constexpr size_t ORDER_CHUNK_MAX = 512;
+
+// One line of the hot key cache: which bucket a hot key is in and how often it's been hit
+struct HotCacheLine {
+    size_t hash;
+    size_t bucket;
+    uint32_t hits;
+};
+
+// enum types for what merge does when both tables have the same key
+enum class MergePolicy {KEEP_EXISTING, TAKE_INCOMING, SUM};
+
+// Counters for things the table did on its own, and what its arrays ended up backed by
+struct HashTableStats {
+    size_t evictions;
+    size_t expirations;
+    PageBacking bucketBacking;
+    PageBacking offsetBacking;
+};
+
+// Where a table's memory goes, in bytes. Slack is memory that's allocated but holds nothing:
+// spare vector capacity, allocation headers, huge page rounding and removed keys' string buffers.
+struct HashTableMemory {
+    size_t entries;
+    size_t bucketBytes;
+    size_t metadataBytes;
+    size_t keyBytes;
+    size_t sideTableBytes;
+    size_t slackBytes;
+    size_t total() const { return bucketBytes + metadataBytes + keyBytes + sideTableBytes + slackBytes; }
+    double bytesPerEntry() const { return entries == 0 ? 0.0 : static_cast<double>(total()) / entries; }
+};
 
 class HashTableBucket {
     public:
         // HashTableBucket variables
         bucketType type;
+        // CLOCK reference bit and expiry time, both fit in the padding after type
+        mutable uint8_t referenced;
+        uint32_t expiry;
         std::string bucketKey;
         size_t bucketValue;
         // HashTableBucket default constructor declaration
@@ -34,13 +103,78 @@ class HashTableBucket {
         // HashTableBucket function declarations
         void load(const std::string& key, const size_t& value);
         bool isEmpty() const;
+        bool isLive() const;
+        void takeFrom(HashTableBucket& other);
+};
+
+/**
+* Forward iterator over the full buckets of a HashTable. Empty (ESS and EAR) buckets are skipped
+* by looking only at the bucket type, so walking the table never copies a key. Dereferencing
+* gives a pair of references, so range-for can unpack it: for (auto [key, value] : ht)
+* Since that pair is a proxy and not a real reference, the classic category is only input, and
+* C++20 code that asks for iterator_concept still sees a forward iterator.
+*/
+
+template <typename Bucket, typename Value>
+class HashTableIterator {
+    public:
+        // Iterator traits
+        using iterator_category = input_iterator_tag;
+        using iterator_concept = forward_iterator_tag;
+        using difference_type = ptrdiff_t;
+        using value_type = pair<const std::string, remove_const_t<Value>>;
+        using reference = pair<const std::string&, Value&>;
+        using pointer = void;
+        // HashTableIterator constructor declarations
+        HashTableIterator() : buckets(nullptr), pos(0), count(0) {}
+        HashTableIterator(Bucket* buckets, size_t pos, size_t count) : buckets(buckets), pos(pos), count(count) {
+            // Start on a full bucket
+            skipEmpty();
+        }
+        // Lets an iterator turn into a const_iterator
+        template <typename OtherBucket, typename OtherValue>
+        requires is_convertible_v<OtherBucket*, Bucket*>
+        HashTableIterator(const HashTableIterator<OtherBucket, OtherValue>& other)
+            : buckets(other.buckets), pos(other.pos), count(other.count) {}
+        // HashTableIterator function declarations
+        reference operator*() const { return {buckets[pos].bucketKey, buckets[pos].bucketValue}; }
+        const std::string& key() const { return buckets[pos].bucketKey; }
+        Value& value() const { return buckets[pos].bucketValue; }
+        size_t index() const { return pos; }
+        HashTableIterator& operator++() {
+            // Move past this bucket and on to the next full one
+            pos++;
+            skipEmpty();
+            return *this;
+        }
+        HashTableIterator operator++(int) {
+            HashTableIterator old = *this;
+            ++*this;
+            return old;
+        }
+        bool operator==(const HashTableIterator& other) const { return pos == other.pos; }
+        // HashTableIterator variables
+        Bucket* buckets;
+        size_t pos;
+        size_t count;
+    private:
+        void skipEmpty() {
+            // Only the type and expiry are checked, the key is never touched for empty buckets
+            while (pos < count && !buckets[pos].isLive()) {
+                pos++;
+            }
+        }
 };
 
+// Bucket and offset arrays, which can be put in huge pages
+using BucketVector = vector<HashTableBucket, HugePageAllocator<HashTableBucket>>;
+using OffsetVector = vector<size_t, HugePageAllocator<size_t>>;
+
 class HashTable {
     public:
         // HashTable variables
-        vector <size_t> offsets;
-        vector <HashTableBucket> table;
+        OffsetVector offsets;
+        BucketVector table;
         size_t filled;
         size_t max;
         // HashTable constructor declaration
@@ -60,6 +194,226 @@ class HashTable {
         std::string printMe(int i) const;
         static vector <size_t> offsetShuffle(size_t newCap) ;
         void resizeTable();
+        bool saveSnapshot(const std::string& path) const;
+        bool saveSnapshot(ostream& os) const;
+        static optional<HashTable> loadSnapshot(const std::string& path);
+        FrozenHashTable freeze() const;
+        // Iterators over the full buckets
+        using iterator = HashTableIterator<HashTableBucket, size_t>;
+        using const_iterator = HashTableIterator<const HashTableBucket, const size_t>;
+        iterator begin();
+        iterator end();
+        const_iterator begin() const;
+        const_iterator end() const;
+        // Parallel scans over the bucket array
+        size_t parallelParts(size_t threads) const;
+        void parallelRanges(size_t threads, const function<void(size_t, size_t, size_t)>& work) const;
+        template <typename Fn>
+        void parallel_for_each(Fn fn, size_t threads = 0);
+        template <typename T, typename Map, typename Combine>
+        T parallel_reduce(T init, Map map, Combine combine, size_t threads = 0) const;
+        template <typename Pred>
+        size_t erase_if(Pred pred, size_t threads = 0);
+        void purge();
+        size_t emptySlot(const std::string& key) const;
+        void dump(ostream& os, DumpFormat format = DumpFormat::TEXT) const;
+        // Single probe lookups and inserts
+        size_t locate(const std::string& key, size_t* firstEmpty = nullptr) const;
+        size_t locate(const std::string& key, size_t hash, size_t* firstEmpty = nullptr) const;
+        pair<size_t, bool> claim(const std::string& key);
+        iterator find(const std::string& key);
+        const_iterator find(const std::string& key) const;
+        pair<iterator, bool> try_emplace(const std::string& key, const size_t& value);
+        pair<iterator, bool> try_emplace(std::string&& key, const size_t& value);
+        pair<iterator, bool> insert_or_assign(const std::string& key, const size_t& value);
+        template <typename Fn>
+        pair<iterator, bool> upsert(const std::string& key, const size_t& initial, Fn fn);
+        template <typename Fn>
+        bool update(const std::string& key, Fn fn);
+        // Moving whole tables together
+        size_t merge(HashTable&& other, MergePolicy policy = MergePolicy::KEEP_EXISTING);
+        static HashTable mergeAll(vector<HashTable>&& parts, MergePolicy policy = MergePolicy::KEEP_EXISTING, size_t threads = 0);
+        static void resolveConflict(size_t& existing, size_t incoming, MergePolicy policy);
+        static size_t capacityFor(size_t count, size_t cap = 8);
+        // Bloom filter in front of the buckets for fast misses
+        BloomFilter filter;
+        size_t filterBitsPerKey;
+        void enableFilter(size_t bitsPerKey = 10);
+        void disableFilter();
+        void rebuildFilter();
+        // Direct-mapped cache of hot keys' buckets
+        mutable vector <HotCacheLine> hotCache;
+        static void recordHot(HotCacheLine& line, size_t hash, size_t bucket);
+        void enableHotCache(size_t lines = 1024);
+        void disableHotCache();
+        size_t relocateHot();
+        // Bounded cache mode with CLOCK eviction and per-key expiry
+        size_t usedBytes;
+        size_t maxEntries;
+        size_t maxBytes;
+        size_t clockHand;
+        size_t evictedSincePurge;
+        HashTableStats counters;
+        void setCapacityLimit(size_t entries, size_t bytes = 0);
+        bool expireAfter(const std::string& key, uint32_t seconds);
+        size_t locateLive(const std::string& key) const;
+        size_t locateLive(const std::string& key, size_t hash) const;
+        void markUsed(const HashTableBucket& bucket) const;
+        bool evictOne();
+        bool makeRoom(size_t need);
+        bool trimToLimit();
+        HashTableStats stats() const;
+        static uint32_t nowSeconds();
+        static uint64_t wallSeconds();
+        static uint64_t wallExpiry(uint32_t expiry);
+        static uint32_t localExpiry(uint64_t wall);
+        static bool isExpired(const HashTableBucket& bucket);
+        // How many full buckets expire at each time, so size() can leave out expired keys
+        map <uint32_t, size_t> expiryCounts;
+        void addExpiry(uint32_t expiry);
+        void dropExpiry(uint32_t expiry);
+        size_t expiredCount() const;
+        static size_t entryBytes(const std::string& key);
+        void rebuild(size_t newCap);
+        // Ordered index of bucket numbers, sorted by key in chunks, for range and prefix queries
+        bool orderEnabled;
+        mutable vector <vector<size_t>> orderChunks;
+        mutable vector <size_t> orderPending;
+        void enableOrderedIndex();
+        void disableOrderedIndex();
+        vector<const_iterator> range(const std::string& lo, const std::string& hi) const;
+        vector<const_iterator> prefix(const std::string& p) const;
+        bool orderLess(size_t a, size_t b) const;
+        size_t orderChunkFor(const std::string& key) const;
+        void orderAdd(size_t bucket);
+        void orderInsert(size_t bucket) const;
+        void orderErase(size_t bucket);
+        void orderMove(size_t from, size_t to);
+        void flushOrder() const;
+        void orderLayout(const vector<size_t>& sorted) const;
+        void rebuildOrder();
+        // Huge page backing for the bucket and offset arrays
+        PageMode pageMode;
+        void setPageMode(PageMode mode);
+        void shuffleOffsets(size_t newCap);
+        // Memory footprint accounting
+        HashTableMemory memory_usage() const;
         // Hasher declaration
         std::hash<std::string> hasher;
-};
\ No newline at end of file
+};
+
+/**
+* upsert inserts <key, initial> if the key is new, or calls fn(value) on the existing value if it
+* isn't, all in one probe. Counting is upsert(key, 1, [](size_t& v) { v++; }). Returns an iterator
+* to the key's pair and whether it was inserted.
+*/
+
+template <typename Fn>
+pair<HashTable::iterator, bool> HashTable::upsert(const std::string& key, const size_t& initial, Fn fn) {
+    auto result = try_emplace(key, initial);
+    // An existing value gets updated in place
+    if (!result.second) {
+        fn(result.first.value());
+    }
+    return result;
+}
+
+/**
+* update calls fn(value) on the key's value if the key is in the table and returns true, or
+* returns false without inserting anything if it isn't.
+*/
+
+template <typename Fn>
+bool HashTable::update(const std::string& key, Fn fn) {
+    size_t hole = locateLive(key);
+    // The key was not in the table
+    if (hole == max) {
+        return false;
+    }
+    fn(table[hole].bucketValue);
+    return true;
+}
+
+/**
+* parallel_for_each calls fn(key, value) once for every key-value pair, splitting the buckets into
+* ranges that each get their own thread. fn gets a reference to the value so it can update it,
+* but it must not insert or remove, and it must be safe to call from several threads at once.
+*/
+
+template <typename Fn>
+void HashTable::parallel_for_each(Fn fn, size_t threads) {
+    parallelRanges(threads, [this, &fn](size_t first, size_t last, size_t) {
+        // Each thread only walks its own range of buckets
+        for (size_t i = first; i < last; i++) {
+            if (table[i].isLive()) {
+                fn(static_cast<const std::string&>(table[i].bucketKey), table[i].bucketValue);
+            }
+        }
+    });
+}
+
+/**
+* parallel_reduce maps every key-value pair to a T with map(key, value), folds each range into
+* its own partial result with combine, and then combines the partials in order, starting from
+* init. combine should be associative, since the ranges are folded separately.
+*/
+
+template <typename T, typename Map, typename Combine>
+T HashTable::parallel_reduce(T init, Map map, Combine combine, size_t threads) const {
+    // One partial result per range, written only by that range's thread
+    vector<optional<T>> partials(parallelParts(threads));
+    parallelRanges(threads, [this, &map, &combine, &partials](size_t first, size_t last, size_t part) {
+        optional<T> partial;
+        for (size_t i = first; i < last; i++) {
+            if (table[i].isLive()) {
+                T mapped = map(table[i].bucketKey, table[i].bucketValue);
+                partial = partial ? combine(std::move(*partial), std::move(mapped)) : std::move(mapped);
+            }
+        }
+        partials[part] = std::move(partial);
+    });
+    // Fold the partials together
+    T result = std::move(init);
+    for (optional<T>& partial : partials) {
+        if (partial) {
+            result = combine(std::move(result), std::move(*partial));
+        }
+    }
+    return result;
+}
+
+/**
+* erase_if removes every key-value pair where pred(key, value) is true. The buckets are checked in
+* parallel and matches are marked EAR, then the table is purged once so the new tombstones don't
+* lengthen later probes. Like parallel_for_each, pred runs on several threads at once, so it has
+* to be safe to call that way, pass threads = 1 to run it on the calling thread only. Returns how
+* many pairs were removed.
+*/
+
+template <typename Pred>
+size_t HashTable::erase_if(Pred pred, size_t threads) {
+    // How many each range removed, written only by that range's thread
+    vector<size_t> removed(parallelParts(threads), 0);
+    parallelRanges(threads, [this, &pred, &removed](size_t first, size_t last, size_t part) {
+        for (size_t i = first; i < last; i++) {
+            if (table[i].isLive()
+                && pred(static_cast<const std::string&>(table[i].bucketKey), static_cast<const size_t&>(table[i].bucketValue))) {
+                // Same thing remove does to a bucket, purge fixes up usedBytes afterwards
+                table[i].load("", 0);
+                table[i].type = bucketType::EAR;
+                removed[part]++;
+            }
+        }
+    });
+    // Add up the removals
+    size_t total = 0;
+    for (size_t count : removed) {
+        total += count;
+    }
+    filled -= total;
+    // Clear out the tombstones if anything was removed
+    if (total > 0) {
+        purge();
+    }
+    return total;
+}
@@ -0,0 +1,577 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the header file for the HashTable_t class template. It works the same way as HashTable
+* (home bucket, then shuffled probe offsets, ESS and EAR buckets, growing at half full) but the
+* key and value types are template parameters. Keys and values are built in place inside a bucket
+* only when the bucket is in use, so values don't need a default constructor and move-only values
+* like unique_ptr work. This file includes: The HashTable_t constructors, destructor and
+* assignment operators, the insert function, the try_emplace function, the emplace function, the
+* insert_or_assign function, the remove function, the contains function, the find functions, the
+* get function, the [] operator override, the keys function, the alpha function, the capacity
+* function, the size function, the << operator override, the locate function, the emptySlot
+* function, the resizeTable function, the offsetShuffle function, the iterators, the HashTableSlot
+* class.
+* -----------------------------------------------------------------------------------------*/
+#pragma once
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <ostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// enum types for HashTable_t slots, same meaning as HashTable's bucketType
+enum class slotType {NORMAL, ESS, EAR};
+
+/**
+* One bucket of a HashTable_t. The key and value live in raw storage inside the bucket and only
+* exist while the bucket is NORMAL, so an ESS or EAR bucket never constructs or destroys either.
+*/
+
+template <typename K, typename V>
+class HashTableSlot {
+    public:
+        // HashTableSlot variables
+        slotType type = slotType::ESS;
+        alignas(K) unsigned char keyStorage[sizeof(K)];
+        alignas(V) unsigned char valueStorage[sizeof(V)];
+        // HashTableSlot function declarations
+        K& key() { return *std::launder(reinterpret_cast<K*>(keyStorage)); }
+        const K& key() const { return *std::launder(reinterpret_cast<const K*>(keyStorage)); }
+        V& value() { return *std::launder(reinterpret_cast<V*>(valueStorage)); }
+        const V& value() const { return *std::launder(reinterpret_cast<const V*>(valueStorage)); }
+        bool isEmpty() const { return type != slotType::NORMAL; }
+        // Builds the key and value in place and marks the slot NORMAL
+        template <typename KeyArg, typename... Args>
+        void construct(KeyArg&& keyArg, Args&&... args) {
+            ::new (static_cast<void*>(keyStorage)) K(std::forward<KeyArg>(keyArg));
+            try {
+                ::new (static_cast<void*>(valueStorage)) V(std::forward<Args>(args)...);
+            } catch (...) {
+                // Don't leave half a pair behind
+                key().~K();
+                throw;
+            }
+            type = slotType::NORMAL;
+        }
+        // Destroys the key and value and marks the slot with the given empty type
+        void destroy(slotType emptyType) {
+            if (type == slotType::NORMAL) {
+                value().~V();
+                key().~K();
+            }
+            type = emptyType;
+        }
+};
+
+/**
+* Forward iterator over the full slots of a HashTable_t. Dereferencing gives a pair of references
+* so range-for can unpack it: for (auto& [key, value] : ht) doesn't copy either one. The pair is
+* a proxy, so like HashTableIterator the classic category is input and iterator_concept is forward.
+*/
+
+template <typename Slot, typename K, typename V>
+class HashTableSlotIterator {
+    public:
+        // Iterator traits
+        using iterator_category = input_iterator_tag;
+        using iterator_concept = forward_iterator_tag;
+        using difference_type = ptrdiff_t;
+        using value_type = pair<const K, remove_const_t<V>>;
+        using reference = pair<const K&, V&>;
+        using pointer = void;
+        // HashTableSlotIterator constructor declarations
+        HashTableSlotIterator() : slots(nullptr), pos(0), count(0) {}
+        HashTableSlotIterator(Slot* slots, size_t pos, size_t count) : slots(slots), pos(pos), count(count) {
+            // Start on a full slot
+            skipEmpty();
+        }
+        // HashTableSlotIterator function declarations
+        reference operator*() const { return {slots[pos].key(), slots[pos].value()}; }
+        const K& key() const { return slots[pos].key(); }
+        V& value() const { return slots[pos].value(); }
+        size_t index() const { return pos; }
+        HashTableSlotIterator& operator++() {
+            // Move past this slot and on to the next full one
+            pos++;
+            skipEmpty();
+            return *this;
+        }
+        HashTableSlotIterator operator++(int) {
+            HashTableSlotIterator old = *this;
+            ++*this;
+            return old;
+        }
+        bool operator==(const HashTableSlotIterator& other) const { return pos == other.pos; }
+        // HashTableSlotIterator variables
+        Slot* slots;
+        size_t pos;
+        size_t count;
+    private:
+        void skipEmpty() {
+            while (pos < count && slots[pos].type != slotType::NORMAL) {
+                pos++;
+            }
+        }
+};
+
+template <typename K, typename V>
+class HashTable_t {
+    public:
+        using Slot = HashTableSlot<K, V>;
+        using iterator = HashTableSlotIterator<Slot, K, V>;
+        using const_iterator = HashTableSlotIterator<const Slot, K, const V>;
+        // HashTable_t variables
+        vector <size_t> offsets;
+        unique_ptr<Slot[]> table;
+        size_t filled;
+        size_t max;
+        // HashTable_t constructor declarations
+        explicit HashTable_t(size_t cap = 8);
+        HashTable_t(const HashTable_t& other) requires is_copy_constructible_v<K> && is_copy_constructible_v<V>;
+        HashTable_t(HashTable_t&& other) noexcept;
+        HashTable_t& operator=(HashTable_t other) noexcept;
+        ~HashTable_t();
+        // HashTable_t function declarations
+        bool insert(const K& key, V value);
+        template <typename KeyArg, typename... Args>
+        pair<iterator, bool> try_emplace(KeyArg&& key, Args&&... args);
+        template <typename... Args>
+        pair<iterator, bool> emplace(const K& key, Args&&... args);
+        pair<iterator, bool> insert_or_assign(const K& key, V value);
+        bool remove(const K& key);
+        bool contains(const K& key) const;
+        iterator find(const K& key);
+        const_iterator find(const K& key) const;
+        optional<V> get(const K& key) const requires is_copy_constructible_v<V>;
+        V& operator[](const K& key);
+        vector<K> keys() const;
+        double alpha() const;
+        size_t capacity() const;
+        size_t size() const;
+        size_t locate(const K& key, size_t* firstEmpty = nullptr) const;
+        size_t emptySlot(const K& key) const;
+        void resizeTable();
+        static vector <size_t> offsetShuffle(size_t newCap);
+        iterator begin() { return iterator(table.get(), 0, max); }
+        iterator end() { return iterator(table.get(), max, max); }
+        const_iterator begin() const { return const_iterator(table.get(), 0, max); }
+        const_iterator end() const { return const_iterator(table.get(), max, max); }
+        template <typename K2, typename V2>
+        friend ostream& operator<<(ostream& os, const HashTable_t<K2, V2>& ht);
+        // Hasher declaration
+        std::hash<K> hasher;
+};
+
+/**
+* The constructor takes an initial capacity, 8 if none is given. None of the slots construct a
+* key or value until something is inserted into them.
+*/
+
+template <typename K, typename V>
+HashTable_t<K, V>::HashTable_t(size_t cap) {
+    // A table needs at least one bucket
+    max = std::max<size_t>(cap, 1);
+    // Tracks size
+    filled = 0;
+    // Every slot starts ESS with nothing built in it
+    table = make_unique<Slot[]>(max);
+    // Same shuffled offsets as HashTable
+    offsets = offsetShuffle(max);
+}
+
+/**
+* The copy constructor copies every full slot into the same index, so the copy probes the same
+* way the original does. If copying a key or value throws, the pairs already copied are destroyed
+* before the exception goes on, since the destructor never runs for a half built table.
+*/
+
+template <typename K, typename V>
+HashTable_t<K, V>::HashTable_t(const HashTable_t& other) requires is_copy_constructible_v<K> && is_copy_constructible_v<V>
+    : offsets(other.offsets), table(make_unique<Slot[]>(other.max)), filled(other.filled), max(other.max) {
+    try {
+        for (size_t i = 0; i < max; i++) {
+            if (!other.table[i].isEmpty()) {
+                table[i].construct(other.table[i].key(), other.table[i].value());
+            }
+            // EAR slots have to stay EAR so probes still walk past them
+            table[i].type = other.table[i].type;
+        }
+    } catch (...) {
+        // Slots that weren't reached are still ESS, so destroying every slot is safe
+        for (size_t i = 0; i < max; i++) {
+            table[i].destroy(slotType::ESS);
+        }
+        throw;
+    }
+}
+
+/**
+* The move constructor takes the other table's slots without allocating anything. The other table
+* is left with no slots at all: lookups miss, it can be assigned to or destroyed, and the first
+* insert gives it slots again.
+*/
+
+template <typename K, typename V>
+HashTable_t<K, V>::HashTable_t(HashTable_t&& other) noexcept
+    : offsets(std::move(other.offsets)), table(std::move(other.table)), filled(other.filled), max(other.max) {
+    other.offsets.clear();
+    other.filled = 0;
+    other.max = 0;
+}
+
+/**
+* Assignment takes its argument by value, so it copies or moves and then swaps.
+*/
+
+template <typename K, typename V>
+HashTable_t<K, V>& HashTable_t<K, V>::operator=(HashTable_t other) noexcept {
+    swap(offsets, other.offsets);
+    swap(table, other.table);
+    swap(filled, other.filled);
+    swap(max, other.max);
+    return *this;
+}
+
+/**
+* The destructor only destroys keys and values in slots that are in use.
+*/
+
+template <typename K, typename V>
+HashTable_t<K, V>::~HashTable_t() {
+    if (table) {
+        for (size_t i = 0; i < max; i++) {
+            table[i].destroy(slotType::ESS);
+        }
+    }
+}
+
+/**
+* insert adds the pair if the key isn't already in the table and returns whether it did. The
+* value is moved into the slot.
+*/
+
+template <typename K, typename V>
+bool HashTable_t<K, V>::insert(const K& key, V value) {
+    return try_emplace(key, std::move(value)).second;
+}
+
+/**
+* try_emplace builds the value in place from args if the key is new. If the key is already there
+* nothing is built and args aren't touched, so a move-only argument is left as it was. Returns an
+* iterator to the key's pair and whether it was inserted, with a single probe.
+*/
+
+template <typename K, typename V>
+template <typename KeyArg, typename... Args>
+pair<typename HashTable_t<K, V>::iterator, bool> HashTable_t<K, V>::try_emplace(KeyArg&& key, Args&&... args) {
+    // Look for the key and the first open slot in one walk
+    size_t open;
+    size_t hole = locate(key, &open);
+    // The key is already there
+    if (hole != max) {
+        return {iterator(table.get(), hole, max), false};
+    }
+    // If the table is half full (or has no slots) it gets expanded, and the open slot moves
+    if (max == 0 || alpha() >= 0.5) {
+        resizeTable();
+        open = emptySlot(key);
+    }
+    // Build the pair right in the slot
+    table[open].construct(std::forward<KeyArg>(key), std::forward<Args>(args)...);
+    // Increase size counter
+    filled++;
+    return {iterator(table.get(), open, max), true};
+}
+
+/**
+* emplace is try_emplace with a const key, matching the std::unordered_map name.
+*/
+
+template <typename K, typename V>
+template <typename... Args>
+pair<typename HashTable_t<K, V>::iterator, bool> HashTable_t<K, V>::emplace(const K& key, Args&&... args) {
+    return try_emplace(key, std::forward<Args>(args)...);
+}
+
+/**
+* insert_or_assign inserts the pair if the key is new, or move-assigns the value over the old one
+* if it isn't.
+*/
+
+template <typename K, typename V>
+pair<typename HashTable_t<K, V>::iterator, bool> HashTable_t<K, V>::insert_or_assign(const K& key, V value) {
+    size_t hole = locate(key);
+    // Overwrite an existing value
+    if (hole != max) {
+        table[hole].value() = std::move(value);
+        return {iterator(table.get(), hole, max), false};
+    }
+    return try_emplace(key, std::move(value));
+}
+
+/**
+* remove destroys the key and value in the key's slot and marks it EAR.
+*/
+
+template <typename K, typename V>
+bool HashTable_t<K, V>::remove(const K& key) {
+    size_t hole = locate(key);
+    // The key was not in the table
+    if (hole == max) {
+        return false;
+    }
+    // Destroy the pair and leave a tombstone
+    table[hole].destroy(slotType::EAR);
+    // Decrease size counter
+    filled--;
+    return true;
+}
+
+/**
+* contains returns true if the key is in the table.
+*/
+
+template <typename K, typename V>
+bool HashTable_t<K, V>::contains(const K& key) const {
+    return locate(key) != max;
+}
+
+/**
+* find returns an iterator to the key's pair or end(). Unlike get this never copies the value,
+* so it works for move-only values.
+*/
+
+template <typename K, typename V>
+typename HashTable_t<K, V>::iterator HashTable_t<K, V>::find(const K& key) {
+    return iterator(table.get(), locate(key), max);
+}
+
+template <typename K, typename V>
+typename HashTable_t<K, V>::const_iterator HashTable_t<K, V>::find(const K& key) const {
+    return const_iterator(table.get(), locate(key), max);
+}
+
+/**
+* get returns a copy of the key's value, or nullopt if the key isn't in the table. Only there
+* for values that can be copied.
+*/
+
+template <typename K, typename V>
+optional<V> HashTable_t<K, V>::get(const K& key) const requires is_copy_constructible_v<V> {
+    size_t hole = locate(key);
+    // The key was not in the table, return nullopt
+    if (hole == max) {
+        return nullopt;
+    }
+    return table[hole].value();
+}
+
+/**
+* The bracket operator returns a reference to the key's value, and throws an exception if the key
+* isn't in the table, the same as HashTable.
+*/
+
+template <typename K, typename V>
+V& HashTable_t<K, V>::operator[](const K& key) {
+    size_t hole = locate(key);
+    // The key is not in the table, throw exception
+    if (hole == max) {
+        throw exception();
+    }
+    return table[hole].value();
+}
+
+/**
+* keys returns a copy of every key in the table.
+*/
+
+template <typename K, typename V>
+vector<K> HashTable_t<K, V>::keys() const {
+    vector<K> keys;
+    keys.reserve(filled);
+    for (auto it = begin(); it != end(); ++it) {
+        keys.push_back(it.key());
+    }
+    return keys;
+}
+
+/**
+* alpha returns the load factor, size/capacity, or 0 for a table with no slots.
+*/
+
+template <typename K, typename V>
+double HashTable_t<K, V>::alpha() const {
+    if (max == 0) {
+        return 0;
+    }
+    return static_cast<double>(filled) / static_cast<double>(max);
+}
+
+/**
+* capacity returns how many slots are in the table.
+*/
+
+template <typename K, typename V>
+size_t HashTable_t<K, V>::capacity() const {
+    return max;
+}
+
+/**
+* size returns how many key-value pairs are in the table.
+*/
+
+template <typename K, typename V>
+size_t HashTable_t<K, V>::size() const {
+    return filled;
+}
+
+/**
+* locate walks the key's probe sequence once and returns the key's slot, or max if it isn't in
+* the table. If firstEmpty isn't null it gets the first empty slot passed along the way.
+*/
+
+template <typename K, typename V>
+size_t HashTable_t<K, V>::locate(const K& key, size_t* firstEmpty) const {
+    // Nothing empty seen yet
+    if (firstEmpty != nullptr) {
+        *firstEmpty = max;
+    }
+    // A moved-from table has no slots to look in
+    if (max == 0) {
+        return max;
+    }
+    // Hash the key
+    size_t home = hasher(key) % max;
+    // Check the home index and then every probed index
+    for (size_t i = 0; i < max; i++) {
+        size_t hole = (i == 0) ? home : (home + offsets[i - 1]) % max;
+        const Slot& slot = table[hole];
+        // If the key is at this index
+        if (slot.type == slotType::NORMAL) {
+            if (slot.key() == key) {
+                return hole;
+            }
+            continue;
+        }
+        // Remember the first empty slot for inserting
+        if (firstEmpty != nullptr && *firstEmpty == max) {
+            *firstEmpty = hole;
+        }
+        // If ESS, stop trying
+        if (slot.type == slotType::ESS) {
+            return max;
+        }
+    }
+    // The key was not in the table
+    return max;
+}
+
+/**
+* emptySlot returns the first empty slot on the key's probe sequence.
+*/
+
+template <typename K, typename V>
+size_t HashTable_t<K, V>::emptySlot(const K& key) const {
+    size_t home = hasher(key) % max;
+    for (size_t i = 0; i < max; i++) {
+        size_t hole = (i == 0) ? home : (home + offsets[i - 1]) % max;
+        if (table[hole].isEmpty()) {
+            return hole;
+        }
+    }
+    // A full table has no open slot, hand back the home index
+    return home;
+}
+
+/**
+* resizeTable doubles the capacity and moves every pair into the new slots. Keys and values are
+* moved unless either one's move can throw and both can be copied, in which case they're copied
+* (the same rule std::vector uses). If anything throws partway, the new slots are destroyed and the
+* old table is put back, so nothing leaks and, when copying, nothing is lost. The old slots are
+* only destroyed once every pair has made it across. A table with no slots gets the default 8.
+*/
+
+template <typename K, typename V>
+void HashTable_t<K, V>::resizeTable() {
+    constexpr bool copyOnResize = !(is_nothrow_move_constructible_v<K> && is_nothrow_move_constructible_v<V>)
+                                  && is_copy_constructible_v<K> && is_copy_constructible_v<V>;
+    // Take the old slots
+    unique_ptr<Slot[]> oldTable = std::move(table);
+    vector <size_t> oldOffsets = std::move(offsets);
+    size_t oldMax = max;
+    try {
+        // Set up the bigger table
+        table = make_unique<Slot[]>((oldMax == 0) ? 8 : oldMax * 2);
+        max = (oldMax == 0) ? 8 : oldMax * 2;
+        offsets = offsetShuffle(max);
+        // Move every pair across
+        for (size_t i = 0; i < oldMax; i++) {
+            Slot& old = oldTable[i];
+            if (old.isEmpty()) {
+                continue;
+            }
+            // Copy both halves if either move could throw, so the old pair stays whole until the end
+            if constexpr (copyOnResize) {
+                table[emptySlot(old.key())].construct(std::as_const(old.key()), std::as_const(old.value()));
+            } else {
+                table[emptySlot(old.key())].construct(std::move(old.key()), std::move(old.value()));
+            }
+        }
+    } catch (...) {
+        // Throw away whatever made it into the new slots and go back to the old table
+        if (table) {
+            for (size_t i = 0; i < max; i++) {
+                table[i].destroy(slotType::ESS);
+            }
+        }
+        table = std::move(oldTable);
+        offsets = std::move(oldOffsets);
+        max = oldMax;
+        throw;
+    }
+    // Every pair is across, so the old ones can go
+    for (size_t i = 0; i < oldMax; i++) {
+        oldTable[i].destroy(slotType::ESS);
+    }
+}
+
+/**
+* offsetShuffle makes the shuffled probe offsets 1 to newCap - 1, the same way HashTable does.
+*/
+
+template <typename K, typename V>
+vector <size_t> HashTable_t<K, V>::offsetShuffle(size_t newCap) {
+    // Offsets 1 up to the capacity
+    vector <size_t> newOffsets(newCap - 1);
+    for (size_t i = 0; i < newOffsets.size(); i++) {
+        newOffsets[i] = i + 1;
+    }
+    // Shuffle them
+    random_device rd;
+    mt19937 g(rd());
+    shuffle(newOffsets.begin(), newOffsets.end(), g);
+    return newOffsets;
+}
+
+/**
+* operator<< prints every full slot the same way HashTable does: Bucket 5: <James, 4815>
+*/
+
+template <typename K, typename V>
+ostream& operator<<(ostream& os, const HashTable_t<K, V>& ht) {
+    for (auto it = ht.begin(); it != ht.end(); ++it) {
+        os << "Bucket " << it.index() << ": <" << it.key() << ", " << it.value() << ">\n";
+    }
+    return os;
+}
@@ -0,0 +1,255 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the cpp file for the binary snapshot format and the MappedHashTable class. It contains the
+* function definitions for reading a snapshot straight out of a read-only memory mapping. This file
+* includes: The snapshotHashCheck function, the snapshotHeaderValid function, the
+* snapshotRecordValid function, the MappedHashTable constructor and destructor, the open function,
+* the close function, the isOpen function, the contains function, the get function, the capacity
+* function, the size function, the find function.
+* -----------------------------------------------------------------------------------------*/
+
+#include "HashTableSnapshot.h"
+#include "HashTable.h"
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+/**
+* std::hash is only guaranteed to be stable inside one build, so the writer stores the hash of a
+* fixed string and the reader refuses any snapshot where its own hash of that string differs.
+*/
+
+uint64_t snapshotHashCheck() {
+    // Hash a string that never changes
+    return std::hash<std::string>{}("HashTable snapshot hash check");
+}
+
+/**
+* snapshotHeaderValid returns true if the header is for a snapshot this build can read and every
+* section it points at lies inside a file of length bytes, in order. The sizes are checked by
+* division first, so a corrupt capacity can't overflow the position math.
+*/
+
+bool snapshotHeaderValid(const SnapshotHeader& header, size_t length) {
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0
+        || header.version != SNAPSHOT_VERSION
+        || header.recordSize != sizeof(SnapshotBucket)
+        || header.hashCheck != snapshotHashCheck()
+        || header.capacity == 0
+        || header.filled > header.capacity
+        || header.fileSize != length) {
+        return false;
+    }
+    // Offsets, then bucket records, then keys, each starting where the last one ends or later
+    if (header.offsetsPos < sizeof(SnapshotHeader) || header.offsetsPos > length
+        || (header.capacity - 1) > (length - header.offsetsPos) / sizeof(uint64_t)) {
+        return false;
+    }
+    uint64_t offsetsEnd = header.offsetsPos + (header.capacity - 1) * sizeof(uint64_t);
+    if (header.bucketsPos < offsetsEnd || header.bucketsPos > length
+        || header.capacity > (length - header.bucketsPos) / sizeof(SnapshotBucket)) {
+        return false;
+    }
+    uint64_t bucketsEnd = header.bucketsPos + header.capacity * sizeof(SnapshotBucket);
+    return header.keysPos >= bucketsEnd && header.keysPos <= length;
+}
+
+/**
+* snapshotRecordValid returns true if the record's state is ESS, EAR or NORMAL, and a NORMAL
+* record's key bytes lie inside the key section. The header must already have passed
+* snapshotHeaderValid.
+*/
+
+bool snapshotRecordValid(const SnapshotHeader& header, const SnapshotBucket& record, size_t length) {
+    if (record.type > static_cast<uint8_t>(bucketType::EAR)) {
+        return false;
+    }
+    if (record.type != static_cast<uint8_t>(bucketType::NORMAL)) {
+        return true;
+    }
+    uint64_t keySpace = length - header.keysPos;
+    return record.keyOffset <= keySpace && record.keyLength <= keySpace - record.keyOffset;
+}
+
+/**
+* The default constructor leaves the table closed. Nothing can be found until open is called.
+*/
+
+MappedHashTable::MappedHashTable() {
+    // Nothing is mapped yet
+    mapped = nullptr;
+    mappedLength = 0;
+    header = nullptr;
+    offsets = nullptr;
+    buckets = nullptr;
+    keys = nullptr;
+}
+
+/**
+* The destructor unmaps the file if one is open.
+*/
+
+MappedHashTable::~MappedHashTable() {
+    close();
+}
+
+/**
+* open maps a snapshot file written by HashTable::saveSnapshot read-only and checks that the
+* header makes sense and every section fits in the file. Nothing is copied, rehashed or even read
+* past the header, the lookups run directly against the mapping and check each record they touch.
+* Returns false if the file can't be mapped or isn't a snapshot this build can read.
+*/
+
+bool MappedHashTable::open(const std::string& path) {
+    // Drop whatever was open before
+    close();
+    // Open the file
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    // Find out how big it is
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+        ::close(fd);
+        return false;
+    }
+    // Map the whole file read-only
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file alive, so the descriptor isn't needed anymore
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+    mapped = static_cast<const char*>(addr);
+    mappedLength = st.st_size;
+    header = reinterpret_cast<const SnapshotHeader*>(mapped);
+    // Check the header before trusting any of the positions in it
+    if (!snapshotHeaderValid(*header, mappedLength)) {
+        close();
+        return false;
+    }
+    // Point into the sections of the file
+    offsets = reinterpret_cast<const uint64_t*>(mapped + header->offsetsPos);
+    buckets = reinterpret_cast<const SnapshotBucket*>(mapped + header->bucketsPos);
+    keys = mapped + header->keysPos;
+    return true;
+}
+
+/**
+* close unmaps the file. Calling it on a closed table does nothing.
+*/
+
+void MappedHashTable::close() {
+    // If something is mapped, unmap it
+    if (mapped != nullptr) {
+        munmap(const_cast<char*>(mapped), mappedLength);
+    }
+    // Reset back to closed
+    mapped = nullptr;
+    mappedLength = 0;
+    header = nullptr;
+    offsets = nullptr;
+    buckets = nullptr;
+    keys = nullptr;
+}
+
+/**
+* isOpen returns whether a snapshot is currently mapped.
+*/
+
+bool MappedHashTable::isOpen() const {
+    return mapped != nullptr;
+}
+
+/**
+* find walks the same probe sequence HashTable uses, using the offsets stored in the snapshot,
+* and returns the record for the key or nullptr if it isn't there. The stored hash is compared
+* first so the key bytes are only looked at when the hashes already match. Every record passed is
+* checked before it's used, and a damaged one ends the search as a miss. A key whose saved expiry
+* time has passed is a miss too.
+*/
+
+const SnapshotBucket* MappedHashTable::find(const string& key) const {
+    // A closed table has nothing in it
+    if (!isOpen()) {
+        return nullptr;
+    }
+    // Hash the key
+    uint64_t hash = hasher(key);
+    size_t cap = header->capacity;
+    size_t home = hash % cap;
+    // Check the home bucket and then every probed bucket
+    for (size_t i = 0; i < cap; i++) {
+        // The first step is the home bucket, the rest follow the stored offsets
+        size_t hole = (i == 0) ? home : (home + offsets[i - 1]) % cap;
+        const SnapshotBucket& bucket = buckets[hole];
+        // Don't follow a key position that points outside the file
+        if (!snapshotRecordValid(*header, bucket, mappedLength)) {
+            return nullptr;
+        }
+        // If ESS, stop trying
+        if (bucket.type == static_cast<uint8_t>(bucketType::ESS)) {
+            return nullptr;
+        }
+        // If the bucket is full and the hash and key match, this is the one
+        if (bucket.type == static_cast<uint8_t>(bucketType::NORMAL) && bucket.hash == hash
+            && bucket.keyLength == key.size()
+            && memcmp(keys + bucket.keyOffset, key.data(), key.size()) == 0) {
+            // A key whose TTL ran out acts like it isn't there, the same as in HashTable
+            if (bucket.expiresAt != 0 && HashTable::wallSeconds() >= bucket.expiresAt) {
+                return nullptr;
+            }
+            return &bucket;
+        }
+    }
+    // The key was not in the table
+    return nullptr;
+}
+
+/**
+* contains returns true if the key is in the mapped snapshot.
+*/
+
+bool MappedHashTable::contains(const string& key) const {
+    return find(key) != nullptr;
+}
+
+/**
+* get returns the value for the key, or nullopt if the key isn't in the mapped snapshot.
+*/
+
+optional<size_t> MappedHashTable::get(const string& key) const {
+    // Look up the record
+    const SnapshotBucket* bucket = find(key);
+    // The key was not in the table, return nullopt
+    if (bucket == nullptr) {
+        return nullopt;
+    }
+    // Return the key value
+    return bucket->value;
+}
+
+/**
+* capacity returns how many buckets the snapshot was saved with.
+*/
+
+size_t MappedHashTable::capacity() const {
+    return isOpen() ? header->capacity : 0;
+}
+
+/**
+* size returns how many key-value pairs the snapshot holds. Keys that were live when it was saved
+* are counted even if their TTL has run out since.
+*/
+
+size_t MappedHashTable::size() const {
+    return isOpen() ? header->filled : 0;
+}
@@ -0,0 +1,85 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the header file for the binary snapshot format and the MappedHashTable class. A snapshot
+* holds the whole table (bucket states, hashes, keys, values, expiry times and the probe offsets) so
+* it can be reloaded without rehashing anything. This file includes: The snapshot header and bucket
+* record layouts, the snapshotHashCheck function, the snapshotHeaderValid function, the
+* snapshotRecordValid function, the MappedHashTable constructor and destructor, the open function,
+* the close function, the isOpen function, the contains function, the get function, the capacity
+* function, the size function, the find function.
+* -----------------------------------------------------------------------------------------*/
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+// Current version of the snapshot format, 2 added expiry times
+constexpr uint32_t SNAPSHOT_VERSION = 2;
+// Magic bytes at the very start of every snapshot file
+constexpr char SNAPSHOT_MAGIC[8] = {'H', 'T', 'S', 'N', 'A', 'P', '\0', '\0'};
+
+// Fixed size header at the start of a snapshot file
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t capacity;
+    uint64_t filled;
+    uint64_t hashCheck;
+    uint64_t offsetsPos;
+    uint64_t bucketsPos;
+    uint64_t keysPos;
+    uint64_t fileSize;
+};
+
+// One record per bucket, in bucket order, right after the offsets. expiresAt is wall clock
+// seconds since the Unix epoch, or 0 if the key never expires
+struct SnapshotBucket {
+    uint64_t hash;
+    uint64_t value;
+    uint64_t keyOffset;
+    uint64_t expiresAt;
+    uint32_t keyLength;
+    uint8_t type;
+    uint8_t pad[3];
+};
+
+// Hash of a fixed string, used to make sure the reader hashes keys the same way the writer did
+uint64_t snapshotHashCheck();
+// Checks that a header belongs to a snapshot of this length and that its sections fit inside it
+bool snapshotHeaderValid(const SnapshotHeader& header, size_t length);
+// Checks that a record has a real bucket state and, if full, that its key fits inside the file
+bool snapshotRecordValid(const SnapshotHeader& header, const SnapshotBucket& record, size_t length);
+
+class MappedHashTable {
+    public:
+        // MappedHashTable constructor and destructor declarations
+        MappedHashTable();
+        ~MappedHashTable();
+        MappedHashTable(const MappedHashTable&) = delete;
+        MappedHashTable& operator=(const MappedHashTable&) = delete;
+        // MappedHashTable function declarations
+        bool open(const std::string& path);
+        void close();
+        bool isOpen() const;
+        bool contains(const string& key) const;
+        optional<size_t> get(const string& key) const;
+        size_t capacity() const;
+        size_t size() const;
+        const SnapshotBucket* find(const string& key) const;
+    private:
+        // MappedHashTable variables
+        const char* mapped;
+        size_t mappedLength;
+        const SnapshotHeader* header;
+        const uint64_t* offsets;
+        const SnapshotBucket* buckets;
+        const char* keys;
+        // Hasher declaration
+        std::hash<std::string> hasher;
+};
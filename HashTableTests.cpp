@@ -22,6 +22,14 @@
 #include <type_traits>
 #include <optional>
 #include <string>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <memory>
+#include <thread>
 
 using namespace std;
 
@@ -39,6 +47,21 @@ using value_type = size_t;      // or std::string, int, double
 using HashTable = HashTable_t<key_type, value_type>;
 #else
 #include "HashTable.h" // Must match key_type/value_type of the tested HashTable
+#include "HashTableSnapshot.h"
+#include "FrozenHashTable.h"
+#include "HashTableImpl.h"
+#include "HashCounter.h"
+#include "CuckooHashTable.h"
+#include "MultiHashTable.h"
+#include "StaticHashTable.h"
+#include "FixedHashTable.h"
+#include "VersionedHashTable.h"
+#include "DurableHashTable.h"
+#include "TieredHashTable.h"
+#include "ExtendibleHashTable.h"
+#include "ShardedHashTable.h"
+#include "AsyncHashTable.h"
+#include "CompactHashTable.h"
 #endif
 
 // -----------------------------------------------------------------------------
@@ -68,6 +91,41 @@ requires std::is_integral_v<IndexType>
         return static_cast<ValueType>(i + 1);
 }
 
+// -----------------------------------------------------------------------------
+/** Payload used by the HashTable_t tests: no default constructor, counts how many
+ *  instances are alive so leaks and double destroys show up.
+ */
+// -----------------------------------------------------------------------------
+struct Payload {
+    static inline int alive = 0;
+    string name;
+    vector<int> data;
+    Payload(string n, size_t len) : name(std::move(n)), data(len, 1) { alive++; }
+    Payload(const Payload& other) : name(other.name), data(other.data) { alive++; }
+    Payload(Payload&& other) noexcept : name(std::move(other.name)), data(std::move(other.data)) { alive++; }
+    Payload& operator=(const Payload&) = default;
+    Payload& operator=(Payload&&) = default;
+    ~Payload() { alive--; }
+};
+
+// A value whose copy throws once copiesLeft runs out, and whose move isn't noexcept, so a resize
+// has to copy it. copiesLeft < 0 means copies never throw.
+struct Fragile {
+    static inline int alive = 0;
+    static inline int copiesLeft = -1;
+    size_t n;
+    explicit Fragile(size_t n) : n(n) { alive++; }
+    Fragile(const Fragile& other) : n(other.n) {
+        if (copiesLeft == 0)
+            throw exception();
+        if (copiesLeft > 0)
+            copiesLeft--;
+        alive++;
+    }
+    Fragile(Fragile&& other) : n(other.n) { alive++; }
+    ~Fragile() { alive--; }
+};
+
 // -----------------------------------------------------------------------------
 // Output routing and test toggles
 // -----------------------------------------------------------------------------
@@ -102,6 +160,34 @@ const string evalName{""};
 #define HT_ALPHA
 #define HT_CAPACITY
 #define HT_SIZE
+// These cover HashTable-only features, so they're off when testing HashTable_t through USE_IMPL
+#ifndef USE_IMPL
+#define HT_SNAPSHOT
+#define HT_FREEZE
+#define HT_ITERATORS
+#define HT_PARALLEL
+#define HT_DUMP
+#define HT_UPSERT
+#define HT_TEMPLATE_VALUES
+#define HT_COUNTER
+#define HT_MERGE
+#define HT_CUCKOO
+#define HT_FILTER
+#define HT_HOT_CACHE
+#define HT_TTL
+#define HT_MULTIMAP
+#define HT_ORDERED
+#define HT_STATIC
+#define HT_FIXED
+#define HT_VERSIONED
+#define HT_DURABLE
+#define HT_TIERED
+#define HT_EXTENDIBLE
+#define HT_NUMA
+#define HT_HUGE_PAGES
+#define HT_ASYNC
+#define HT_COMPACT
+#endif
 
 // -----------------------------------------------------------------------------
 // Main
@@ -709,6 +795,1443 @@ int main(int, char**) {
     OUTSTREAM << "*** DID NOT TEST SIZE ***" << endl << endl;
 #endif
 
+    // =====================================================================
+    // SNAPSHOT SAVE / LOAD / MAP
+    // =====================================================================
+    OUTSTREAM << "Testing saveSnapshot(), loadSnapshot() and MappedHashTable" << endl;
+    OUTSTREAM << "----------------------------------------------------------" << endl << endl;
+#ifdef HT_SNAPSHOT
+    try {
+        HashTable ht1;
+        const string path = "ht_snapshot_test.bin";
+        OUTSTREAM << "Inserting " << MAXHASH << " entries and removing one..." << endl;
+        for (size_t i = 1; i <= MAXHASH; i++)
+            ht1.insert(make_key<key_type>(i), make_value<value_type>(i));
+        auto remKey = make_key<key_type>(MAXHASH / 2);
+        ht1.remove(remKey);
+
+        OUTSTREAM << "Saving snapshot to " << path << " ..." << endl;
+        bool ok = ht1.saveSnapshot(path);
+
+        OUTSTREAM << "Reloading snapshot and mapping it read-only..." << endl;
+        auto loaded = HashTable::loadSnapshot(path);
+        MappedHashTable mapped;
+        ok &= loaded.has_value() && mapped.open(path);
+        if (ok) {
+            ok &= loaded->size() == ht1.size() && mapped.size() == ht1.size();
+            for (size_t i = 1; i <= MAXHASH; i++) {
+                auto k = make_key<key_type>(i);
+                auto expected = ht1.get(k);
+                bool same = loaded->get(k) == expected && mapped.get(k) == expected;
+                OUTSTREAM << "  get(" << k << ") matches in loaded and mapped -> " << (same ? "true" : "false") << endl;
+                ok &= same;
+            }
+            ok &= !mapped.contains(remKey) && !mapped.contains(make_key<key_type>(MAXHASH + 5));
+        }
+        mapped.close();
+
+        OUTSTREAM << "Loading and mapping corrupted copies..." << endl;
+        ifstream original(path, ios::binary);
+        string bytes((istreambuf_iterator<char>(original)), istreambuf_iterator<char>());
+        original.close();
+        SnapshotHeader header{};
+        memcpy(&header, bytes.data(), sizeof(header));
+        auto write = [&path](const string& corrupt) {
+            ofstream out(path, ios::binary | ios::trunc);
+            out.write(corrupt.data(), static_cast<streamsize>(corrupt.size()));
+        };
+        // A bad header has to be turned away by both readers
+        auto rejected = [&path, &write](const string& corrupt) {
+            write(corrupt);
+            MappedHashTable check;
+            return !HashTable::loadSnapshot(path).has_value() && !check.open(path);
+        };
+        // A bad record is turned away by the loader. The mapping only reads records on lookup, so
+        // a search that runs into the damaged one has to miss instead of reading outside the file
+        auto missed = [&path, &write, &ht1](const string& corrupt, const key_type& damaged) {
+            write(corrupt);
+            MappedHashTable check;
+            bool fine = !HashTable::loadSnapshot(path).has_value() && check.open(path);
+            for (size_t i = 1; i <= MAXHASH && fine; i++) {
+                auto found = check.get(make_key<key_type>(i));
+                fine &= !found.has_value() || found == ht1.get(make_key<key_type>(i));
+            }
+            return fine && !check.contains(damaged);
+        };
+        auto withHeader = [&bytes](SnapshotHeader changed) {
+            string corrupt = bytes;
+            memcpy(corrupt.data(), &changed, sizeof(changed));
+            return corrupt;
+        };
+        SnapshotHeader huge = header;
+        huge.capacity = uint64_t(1) << 40;
+        ok &= rejected(withHeader(huge));
+        SnapshotHeader overlap = header;
+        overlap.bucketsPos = header.offsetsPos;
+        ok &= rejected(withHeader(overlap));
+        SnapshotHeader miscounted = header;
+        miscounted.filled++;
+        write(withHeader(miscounted));
+        ok &= !HashTable::loadSnapshot(path).has_value();
+        ok &= rejected(bytes.substr(0, bytes.size() - 1));
+        // Damage the first full bucket's key position, then give it a state that doesn't exist
+        for (size_t i = 0; i < header.capacity; i++) {
+            SnapshotBucket record{};
+            size_t at = header.bucketsPos + i * sizeof(SnapshotBucket);
+            memcpy(&record, bytes.data() + at, sizeof(record));
+            if (record.type == static_cast<uint8_t>(bucketType::NORMAL)) {
+                key_type damaged = bytes.substr(header.keysPos + record.keyOffset, record.keyLength);
+                string corrupt = bytes;
+                record.keyOffset = bytes.size();
+                memcpy(corrupt.data() + at, &record, sizeof(record));
+                ok &= missed(corrupt, damaged);
+                string badState = bytes;
+                badState[at + offsetof(SnapshotBucket, type)] = 7;
+                ok &= missed(badState, damaged);
+                break;
+            }
+        }
+        std::remove(path.c_str());
+        OUTSTREAM << (ok ? "SUCCESS: snapshot round-tripped through load and mmap."
+                         : "FAILURE: snapshot contents did not match the original table.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST SNAPSHOT ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // FREEZE
+    // =====================================================================
+    OUTSTREAM << "Testing HashTable::freeze() and FrozenHashTable" << endl;
+    OUTSTREAM << "-----------------------------------------------" << endl << endl;
+#ifdef HT_FREEZE
+    try {
+        HashTable ht1;
+        const string path = "ht_frozen_test.bin";
+        OUTSTREAM << "Inserting " << (MAXHASH * 4) << " entries..." << endl;
+        for (size_t i = 1; i <= MAXHASH * 4; i++)
+            ht1.insert(make_key<key_type>(i) + to_string(i), make_value<value_type>(i));
+
+        OUTSTREAM << "Freezing, saving and reloading the frozen table..." << endl;
+        FrozenHashTable frozen = ht1.freeze();
+        bool ok = frozen.size() == ht1.size() && frozen.capacity() == frozen.size();
+        ok &= frozen.save(path);
+        auto reloaded = FrozenHashTable::load(path);
+        std::remove(path.c_str());
+        ok &= reloaded.has_value();
+        for (size_t i = 1; ok && i <= MAXHASH * 4; i++) {
+            auto k = make_key<key_type>(i) + to_string(i);
+            ok &= frozen.get(k) == ht1.get(k) && reloaded->get(k) == ht1.get(k);
+        }
+        ok &= !frozen.contains(make_key<key_type>(MAXHASH + 5)) && frozen.seed == 0;
+
+        OUTSTREAM << "Freezing again on the seeded hash used when two keys tie..." << endl;
+        // A real 64 bit tie can't be made on purpose, so start the build on a seed instead
+        FrozenHashTable seeded(ht1, 3);
+        ok &= seeded.seed == 3 && seeded.size() == ht1.size() && seeded.save(path);
+        auto seededReload = FrozenHashTable::load(path);
+        std::remove(path.c_str());
+        ok &= seededReload.has_value() && seededReload->seed == 3;
+        for (size_t i = 1; ok && i <= MAXHASH * 4; i++) {
+            auto k = make_key<key_type>(i) + to_string(i);
+            ok &= seeded.get(k) == ht1.get(k) && seededReload->get(k) == ht1.get(k);
+        }
+        ok &= !seeded.contains(make_key<key_type>(MAXHASH + 5)) && !seeded.contains("");
+        OUTSTREAM << (ok ? "SUCCESS: frozen table matched the source table with no empty slots."
+                         : "FAILURE: frozen table did not match the source table.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST FREEZE ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // ITERATORS
+    // =====================================================================
+    OUTSTREAM << "Testing HashTable iterators and range-for" << endl;
+    OUTSTREAM << "-----------------------------------------" << endl << endl;
+#ifdef HT_ITERATORS
+    try {
+        HashTable ht1;
+        OUTSTREAM << "Inserting " << MAXHASH << " entries and removing one..." << endl;
+        for (size_t i = 1; i <= MAXHASH; i++)
+            ht1.insert(make_key<key_type>(i), make_value<value_type>(i));
+        ht1.remove(make_key<key_type>(1));
+
+        OUTSTREAM << "Walking the table with range-for and doubling every value..." << endl;
+        size_t visited = 0;
+        for (auto [k, v] : ht1) {
+            OUTSTREAM << "  <" << k << ", " << v << ">" << endl;
+            v *= 2;
+            visited++;
+        }
+        bool ok = (visited == ht1.size());
+        for (size_t i = 2; i <= MAXHASH; i++)
+            ok &= (ht1.get(make_key<key_type>(i)) == make_value<value_type>(i) * 2);
+
+        const HashTable& constRef = ht1;
+        size_t constVisited = 0;
+        for (auto it = constRef.begin(); it != constRef.end(); ++it)
+            constVisited++;
+        ok &= (constVisited == ht1.size()) && (ht1.keys().size() == ht1.size());
+        // Dereferencing gives a proxy pair, so the classic category can only be input
+        using Iter = decltype(ht1.begin());
+        static_assert(is_same_v<iterator_traits<Iter>::iterator_category, input_iterator_tag>);
+        static_assert(std::forward_iterator<Iter>);
+        OUTSTREAM << (ok ? "SUCCESS: iterators visited every live entry exactly once."
+                         : "FAILURE: iterators skipped or repeated entries.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST ITERATORS ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // PARALLEL SCANS
+    // =====================================================================
+    OUTSTREAM << "Testing parallel_for_each(), parallel_reduce() and erase_if()" << endl;
+    OUTSTREAM << "-------------------------------------------------------------" << endl << endl;
+#ifdef HT_PARALLEL
+    try {
+        HashTable ht1;
+        const size_t count = MAXHASH * 4096;
+        OUTSTREAM << "Inserting " << count << " entries..." << endl;
+        for (size_t i = 1; i <= count; i++)
+            ht1.insert(to_string(i), i);
+
+        OUTSTREAM << "Adding 1 to every value in parallel..." << endl;
+        ht1.parallel_for_each([](const string&, size_t& v) { v++; }, 4);
+
+        OUTSTREAM << "Summing every value in parallel..." << endl;
+        size_t sum = ht1.parallel_reduce(size_t{0}, [](const string&, size_t v) { return v; },
+                                         [](size_t a, size_t b) { return a + b; }, 4);
+        size_t expected = count * (count + 1) / 2 + count;
+        bool ok = (sum == expected);
+        OUTSTREAM << "  sum = " << sum << " (expected " << expected << ")" << endl;
+
+        OUTSTREAM << "Erasing every entry with an odd value in parallel..." << endl;
+        size_t removed = ht1.erase_if([](const string&, size_t v) { return v % 2 == 1; }, 4);
+        ok &= (removed == count / 2) && (ht1.size() == count - count / 2);
+        for (size_t i = 1; i <= count; i++)
+            ok &= (ht1.contains(to_string(i)) == ((i + 1) % 2 == 0));
+        size_t tombstones = 0;
+        for (const HashTableBucket& bucket : ht1.table)
+            tombstones += (bucket.type == bucketType::EAR);
+        ok &= (tombstones == 0);
+        OUTSTREAM << (ok ? "SUCCESS: parallel scans matched and erase_if left no tombstones."
+                         : "FAILURE: parallel scan results were wrong.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST PARALLEL ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // DUMP
+    // =====================================================================
+    OUTSTREAM << "Testing HashTable::dump() in TEXT, CSV and JSONL formats" << endl;
+    OUTSTREAM << "--------------------------------------------------------" << endl << endl;
+#ifdef HT_DUMP
+    try {
+        HashTable ht1;
+        OUTSTREAM << "Inserting " << MAXHASH << " entries plus one key that needs escaping..." << endl;
+        for (size_t i = 1; i <= MAXHASH; i++)
+            ht1.insert(make_key<key_type>(i), make_value<value_type>(i));
+        ht1.insert("say \"hi\", ok", 99);
+
+        OUTSTREAM << "Comparing TEXT dump to the printMe lines..." << endl;
+        string expected;
+        for (size_t i = 0; i < ht1.capacity(); i++)
+            if (!ht1.printMe(static_cast<int>(i)).empty())
+                expected += ht1.printMe(static_cast<int>(i)) + "\n";
+        ostringstream text, csv, jsonl;
+        ht1.dump(text);
+        ht1.dump(csv, DumpFormat::CSV);
+        ht1.dump(jsonl, DumpFormat::JSONL);
+        bool ok = (text.str() == expected);
+
+        OUTSTREAM << "Checking CSV and JSONL line counts and escaping..." << endl;
+        auto lines = [](const string& str) { return static_cast<size_t>(std::count(str.begin(), str.end(), '\n')); };
+        ok &= lines(csv.str()) == ht1.size() + 1 && lines(jsonl.str()) == ht1.size();
+        ok &= csv.str().find("\"say \"\"hi\"\", ok\"") != string::npos;
+        ok &= jsonl.str().find("\"key\":\"say \\\"hi\\\", ok\"") != string::npos;
+        OUTSTREAM << jsonl.str();
+        OUTSTREAM << (ok ? "SUCCESS: dump() output matched in every format."
+                         : "FAILURE: dump() output was wrong.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST DUMP ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // TRY_EMPLACE / INSERT_OR_ASSIGN / UPSERT
+    // =====================================================================
+    OUTSTREAM << "Testing try_emplace(), insert_or_assign(), upsert() and update()" << endl;
+    OUTSTREAM << "----------------------------------------------------------------" << endl << endl;
+#ifdef HT_UPSERT
+    try {
+        HashTable ht1;
+        auto k = make_key<key_type>(1);
+        OUTSTREAM << "try_emplace(" << k << ", 1) twice..." << endl;
+        auto first = ht1.try_emplace(k, 1);
+        auto second = ht1.try_emplace(k, 2);
+        bool ok = first.second && !second.second && second.first.value() == 1;
+
+        OUTSTREAM << "insert_or_assign(" << k << ", 7) on an existing key..." << endl;
+        auto assigned = ht1.insert_or_assign(k, 7);
+        ok &= !assigned.second && ht1.get(k) == 7u;
+
+        OUTSTREAM << "Counting " << (MAXHASH * 4) << " tokens with upsert()..." << endl;
+        for (size_t i = 0; i < MAXHASH * 4; i++)
+            ht1.upsert(make_key<key_type>(i % MAXHASH), 1, [](size_t& v) { v++; });
+        for (size_t i = 0; i < MAXHASH; i++) {
+            auto key = make_key<key_type>(i);
+            size_t expected = (key == k) ? 7 + 4 : 4;
+            ok &= ht1.get(key) == expected;
+        }
+        ok &= ht1.size() == MAXHASH;
+
+        OUTSTREAM << "update() on a present and a missing key..." << endl;
+        ok &= ht1.update(k, [](size_t& v) { v = 0; }) && ht1.get(k) == 0u;
+        ok &= !ht1.update(make_key<key_type>(MAXHASH + 5), [](size_t& v) { v = 0; });
+        ok &= !ht1.contains(make_key<key_type>(MAXHASH + 5)) && ht1.find(make_key<key_type>(MAXHASH + 5)) == ht1.end();
+        OUTSTREAM << (ok ? "SUCCESS: single probe insert and update APIs behaved correctly."
+                         : "FAILURE: single probe insert and update APIs misbehaved.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST UPSERT ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // HASHTABLE_T WITH CUSTOM AND MOVE-ONLY VALUES
+    // =====================================================================
+    OUTSTREAM << "Testing HashTable_t with in-place and move-only values" << endl;
+    OUTSTREAM << "------------------------------------------------------" << endl << endl;
+#ifdef HT_TEMPLATE_VALUES
+    try {
+        bool ok = true;
+        {
+            HashTable_t<string, Payload> payloads;
+            OUTSTREAM << "Emplacing " << (MAXHASH * 2) << " payloads in place (forces a resize)..." << endl;
+            for (size_t i = 1; i <= MAXHASH * 2; i++)
+                ok &= payloads.try_emplace(to_string(i), "p" + to_string(i), i).second;
+            ok &= (Payload::alive == static_cast<int>(MAXHASH * 2));
+            OUTSTREAM << "  live payloads = " << Payload::alive << " (one per full slot)" << endl;
+
+            OUTSTREAM << "Removing one and emplacing a duplicate key..." << endl;
+            ok &= payloads.remove("1") && !payloads.try_emplace("2", "dup", 1).second;
+            ok &= (Payload::alive == static_cast<int>(MAXHASH * 2 - 1));
+            auto found = payloads.find("3");
+            ok &= found != payloads.end() && found.value().name == "p3" && found.value().data.size() == 3;
+
+            HashTable_t<string, unique_ptr<int>> owners;
+            OUTSTREAM << "Storing move-only unique_ptr values..." << endl;
+            for (size_t i = 1; i <= MAXHASH * 2; i++)
+                owners.try_emplace(to_string(i), make_unique<int>(static_cast<int>(i)));
+            for (size_t i = 1; i <= MAXHASH * 2; i++)
+                ok &= (*owners[to_string(i)] == static_cast<int>(i));
+            owners.insert_or_assign("1", make_unique<int>(100));
+            ok &= (*owners["1"] == 100) && owners.size() == MAXHASH * 2;
+
+            OUTSTREAM << "Moving a table and reusing the moved-from one..." << endl;
+            HashTable_t<string, unique_ptr<int>> taken(std::move(owners));
+            ok &= taken.size() == MAXHASH * 2 && owners.size() == 0 && owners.capacity() == 0;
+            ok &= !owners.contains("1") && owners.find("1") == owners.end() && owners.begin() == owners.end();
+            ok &= owners.alpha() == 0 && !owners.remove("1") && owners.keys().empty();
+            ok &= owners.try_emplace("again", make_unique<int>(7)).second && *owners["again"] == 7 && owners.capacity() == 8;
+
+            HashTable_t<string, Fragile> fragile(MAXHASH);
+            OUTSTREAM << "Copying a table and growing one when a value's copy throws partway..." << endl;
+            for (size_t i = 0; i < MAXHASH / 2; i++)
+                fragile.try_emplace(to_string(i), i);
+            Fragile::copiesLeft = 2;
+            bool threw = false;
+            try {
+                HashTable_t<string, Fragile> copy(fragile);
+            } catch (exception&) {
+                threw = true;
+            }
+            ok &= threw && Fragile::alive == static_cast<int>(MAXHASH / 2);
+            // The next insert has to grow the table, which copies every value
+            Fragile::copiesLeft = 2;
+            threw = false;
+            try {
+                fragile.try_emplace("grow", MAXHASH);
+            } catch (exception&) {
+                threw = true;
+            }
+            Fragile::copiesLeft = -1;
+            ok &= threw && fragile.capacity() == MAXHASH && fragile.size() == MAXHASH / 2;
+            ok &= Fragile::alive == static_cast<int>(MAXHASH / 2) && fragile.get("1").value().n == 1;
+            ok &= fragile.try_emplace("grow", MAXHASH).second && fragile.capacity() == MAXHASH * 2;
+        }
+        OUTSTREAM << "  live payloads after tables went out of scope = " << Payload::alive << endl;
+        ok &= (Payload::alive == 0 && Fragile::alive == 0);
+        OUTSTREAM << (ok ? "SUCCESS: values were built in place and destroyed exactly once."
+                         : "FAILURE: values were lost, copied or leaked.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST TEMPLATE VALUES ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // HASHCOUNTER
+    // =====================================================================
+    OUTSTREAM << "Testing HashCounter increment(), topK() and mergeAll()" << endl;
+    OUTSTREAM << "------------------------------------------------------" << endl << endl;
+#ifdef HT_COUNTER
+    try {
+        OUTSTREAM << "Counting a token stream in two per-thread counters..." << endl;
+        vector<HashCounter> parts(2);
+        istringstream words("the cat and the dog and the bird");
+        size_t counted = parts[0].incrementAll(words);
+        parts[1].incrementAll(vector<string>{"the", "dog", "dog", "fish"});
+        parts[1].increment("cat", 5);
+        bool ok = (counted == 8) && parts[0].count("the") == 3 && parts[0].count("fish") == 0;
+
+        OUTSTREAM << "Merging and taking the top 3..." << endl;
+        HashCounter merged = HashCounter::mergeAll(parts);
+        auto top = merged.topK(3);
+        for (auto& [word, n] : top)
+            OUTSTREAM << "  " << word << " -> " << n << endl;
+        ok &= top.size() == 3 && top[0] == make_pair(string("cat"), size_t{6})
+              && top[1] == make_pair(string("the"), size_t{4})
+              && top[2] == make_pair(string("dog"), size_t{3});
+        ok &= merged.size() == 6 && merged.count("fish") == 1 && merged.topK(100).size() == 6;
+        OUTSTREAM << (ok ? "SUCCESS: counts, top-K and merge were correct."
+                         : "FAILURE: counter results were wrong.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST COUNTER ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // MERGE / MERGEALL
+    // =====================================================================
+    OUTSTREAM << "Testing HashTable::merge() and HashTable::mergeAll()" << endl;
+    OUTSTREAM << "----------------------------------------------------" << endl << endl;
+#ifdef HT_MERGE
+    try {
+        OUTSTREAM << "Merging two overlapping tables with SUM..." << endl;
+        HashTable ht1, ht2;
+        for (size_t i = 1; i <= MAXHASH; i++) {
+            ht1.insert(to_string(i), i);
+            ht2.insert(to_string(i + MAXHASH / 2), 100);
+        }
+        size_t added = ht1.merge(std::move(ht2), MergePolicy::SUM);
+        bool ok = added == MAXHASH / 2 && ht2.size() == 0 && ht1.size() == MAXHASH + MAXHASH / 2;
+        ok &= ht1.get("1") == 1u && ht1.get(to_string(MAXHASH)) == MAXHASH + 100 && ht1.get(to_string(MAXHASH + 1)) == 100u;
+        ok &= ht1.merge(std::move(ht1), MergePolicy::SUM) == 0 && ht1.size() == MAXHASH + MAXHASH / 2 && ht1.get("1") == 1u;
+
+        const size_t perPart = MAXHASH * 1024;
+        OUTSTREAM << "Merging 4 parts of " << perPart << " keys each across 4 threads..." << endl;
+        vector<HashTable> parts(4);
+        for (size_t p = 0; p < parts.size(); p++)
+            for (size_t i = 0; i < perPart; i++)
+                parts[p].insert(to_string(p * perPart / 2 + i), 1);
+        HashTable merged = HashTable::mergeAll(std::move(parts), MergePolicy::SUM, 4);
+        size_t expectedKeys = 3 * perPart / 2 + perPart;
+        ok &= merged.size() == expectedKeys && merged.keys().size() == expectedKeys && merged.alpha() < 0.5;
+        for (size_t i = 0; i < expectedKeys; i++) {
+            size_t expected = (i < perPart / 2 || i >= 2 * perPart) ? 1 : 2;
+            ok &= merged.get(to_string(i)) == expected;
+        }
+        ok &= parts[0].size() == 0;
+        OUTSTREAM << "  merged size = " << merged.size() << " (expected " << expectedKeys << ")" << endl;
+        OUTSTREAM << (ok ? "SUCCESS: merges moved every key and settled conflicts."
+                         : "FAILURE: merged tables had wrong contents.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST MERGE ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // CUCKOO HASH TABLE
+    // =====================================================================
+    OUTSTREAM << "Testing CuckooHashTable insert(), get() and remove()" << endl;
+    OUTSTREAM << "----------------------------------------------------" << endl << endl;
+#ifdef HT_CUCKOO
+    try {
+        CuckooHashTable ht1;
+        const size_t count = MAXHASH * 2048;
+        OUTSTREAM << "Inserting " << count << " entries..." << endl;
+        bool ok = true;
+        for (size_t i = 1; i <= count; i++)
+            ok &= ht1.insert(to_string(i), i);
+        ok &= !ht1.insert("1", 5) && ht1.size() == count;
+        OUTSTREAM << "  load factor = " << ht1.alpha() << ", stash = " << ht1.stashSize() << endl;
+
+        OUTSTREAM << "Removing every third key and checking the rest..." << endl;
+        for (size_t i = 3; i <= count; i += 3)
+            ok &= ht1.remove(to_string(i));
+        for (size_t i = 1; i <= count; i++) {
+            auto v = ht1.get(to_string(i));
+            ok &= (i % 3 == 0) ? !v.has_value() : (v == i);
+        }
+        ht1["1"] = 42;
+        ok &= ht1.get("1") == 42u && !ht1.contains(to_string(count + 1));
+        ok &= ht1.insert("3", 3) && ht1.get("3") == 3u;
+
+        OUTSTREAM << "Mixing short keys kept in their slots with long keys kept in the arena..." << endl;
+        CuckooHashTable ht2;
+        for (size_t i = 0; i < count; i++)
+            ok &= ht2.insert((i % 2 ? "a-key-that-is-too-long-to-fit-" : "k") + to_string(i), i);
+        ok &= ht2.insert("", 7) && ht2.get("") == 7u && ht2.insert(string(CUCKOO_INLINE_KEY, 'x'), 8);
+        ok &= ht2.get(string(CUCKOO_INLINE_KEY, 'x')) == 8u && !ht2.contains(string(CUCKOO_INLINE_KEY + 1, 'x'));
+        // Removing most long keys packs the arena
+        size_t arenaBefore = ht2.arena.size();
+        for (size_t i = 1; i < count; i += 2)
+            ok &= (i % 8 == 7) || ht2.remove("a-key-that-is-too-long-to-fit-" + to_string(i));
+        ok &= ht2.arena.size() < arenaBefore && ht2.size() == count / 2 + count / 8 + 2;
+        for (size_t i = 0; i < count; i++) {
+            auto v = ht2.get((i % 2 ? "a-key-that-is-too-long-to-fit-" : "k") + to_string(i));
+            ok &= (i % 2 == 0 || i % 8 == 7) ? v == i : !v.has_value();
+        }
+        OUTSTREAM << "  load factor = " << ht2.alpha() << ", arena " << arenaBefore << " -> " << ht2.arena.size()
+                  << " bytes" << endl;
+        OUTSTREAM << (ok ? "SUCCESS: cuckoo table found, updated and removed every key."
+                         : "FAILURE: cuckoo table lost or misreported keys.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST CUCKOO ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // BLOOM FILTER FRONT
+    // =====================================================================
+    OUTSTREAM << "Testing HashTable::enableFilter() for fast misses" << endl;
+    OUTSTREAM << "-------------------------------------------------" << endl << endl;
+#ifdef HT_FILTER
+    try {
+        HashTable ht1;
+        ht1.enableFilter(10);
+        const size_t count = MAXHASH * 1024;
+        OUTSTREAM << "Inserting " << count << " entries with the filter on (forces resizes)..." << endl;
+        for (size_t i = 0; i < count; i++)
+            ht1.insert("key" + to_string(i), i);
+        bool ok = true;
+        for (size_t i = 0; i < count; i++)
+            ok &= ht1.get("key" + to_string(i)) == i;
+
+        OUTSTREAM << "Looking up " << count << " keys that were never inserted..." << endl;
+        size_t passed = 0;
+        for (size_t i = 0; i < count; i++) {
+            string miss = "miss" + to_string(i);
+            passed += ht1.filter.mayContain(ht1.hasher(miss));
+            ok &= !ht1.contains(miss);
+        }
+        double rate = static_cast<double>(passed) / static_cast<double>(count);
+        OUTSTREAM << "  false positive rate = " << rate << endl;
+        ok &= rate < 0.05;
+
+        OUTSTREAM << "Removing keys, then purging to rebuild the filter..." << endl;
+        for (size_t i = 0; i < count; i += 2)
+            ht1.remove("key" + to_string(i));
+        ht1.purge();
+        for (size_t i = 0; i < count; i++)
+            ok &= ht1.contains("key" + to_string(i)) == (i % 2 == 1);
+        ok &= ht1.try_emplace("key0", 7).second && ht1.get("key0") == 7u;
+        OUTSTREAM << (ok ? "SUCCESS: filter turned away misses and never hid a real key."
+                         : "FAILURE: filter gave wrong answers or let too many misses through.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST FILTER ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // HOT KEY CACHE AND RELOCATION
+    // =====================================================================
+    OUTSTREAM << "Testing enableHotCache() and relocateHot()" << endl;
+    OUTSTREAM << "------------------------------------------" << endl << endl;
+#ifdef HT_HOT_CACHE
+    try {
+        HashTable ht1;
+        const size_t count = MAXHASH * 64;
+        for (size_t i = 0; i < count; i++)
+            ht1.insert(to_string(i), i);
+        ht1.enableHotCache(64);
+
+        OUTSTREAM << "Finding a key that sits off its home bucket..." << endl;
+        string hot;
+        size_t hotBucket = 0;
+        for (auto it = ht1.begin(); it != ht1.end(); ++it) {
+            if (ht1.hasher(it.key()) % ht1.capacity() != it.index()) {
+                hot = it.key();
+                hotBucket = it.index();
+                break;
+            }
+        }
+        bool ok = !hot.empty();
+        string blocker = ht1.table[ht1.hasher(hot) % ht1.capacity()].bucketKey;
+        OUTSTREAM << "  hot key " << hot << " is in bucket " << hotBucket << ", its home holds " << blocker << endl;
+
+        OUTSTREAM << "Looking the hot key up 100 times with cold lookups mixed in..." << endl;
+        for (size_t r = 0; r < 100; r++) {
+            ok &= ht1.get(hot) == stoul(hot);
+            ht1.get(to_string(r % count));
+        }
+        const HotCacheLine& line = ht1.hotCache[ht1.hasher(hot) & (ht1.hotCache.size() - 1)];
+        ok &= line.hash == ht1.hasher(hot) && line.bucket == hotBucket && line.hits > 1;
+
+        OUTSTREAM << "Removing the key in its home bucket and relocating hot keys..." << endl;
+        ht1.remove(blocker);
+        size_t moved = ht1.relocateHot();
+        ok &= moved >= 1 && ht1.table[ht1.hasher(hot) % ht1.capacity()].bucketKey == hot;
+        ok &= ht1.get(hot) == stoul(hot) && ht1.size() == count - 1;
+        for (size_t i = 0; i < count; i++)
+            ok &= (to_string(i) == blocker) ? !ht1.contains(blocker) : ht1.get(to_string(i)) == i;
+        OUTSTREAM << (ok ? "SUCCESS: hot key was cached and moved to its home bucket."
+                         : "FAILURE: hot key was not cached or relocated correctly.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST HOT CACHE ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // BOUNDED CACHE MODE (CLOCK EVICTION AND TTL)
+    // =====================================================================
+    OUTSTREAM << "Testing setCapacityLimit() and expireAfter()" << endl;
+    OUTSTREAM << "--------------------------------------------" << endl << endl;
+#ifdef HT_TTL
+    try {
+        HashTable ht1;
+        const size_t limit = MAXHASH * 2;
+        ht1.insert("keep", 1);
+        for (size_t i = 1; i < limit; i++)
+            ht1.insert(to_string(i), i);
+        size_t cap = ht1.capacity();
+        ht1.setCapacityLimit(limit);
+        // Exactly at the limit is still within it
+        bool ok = ht1.size() == limit && ht1.stats().evictions == 0;
+
+        OUTSTREAM << "Inserting 100 more keys into a table limited to " << limit << " keys..." << endl;
+        for (size_t i = limit; i < limit + 100; i++) {
+            ok &= ht1.get("keep") == 1u;
+            ok &= ht1.insert(to_string(i), i);
+            ok &= ht1.size() <= limit;
+        }
+        ok &= ht1.capacity() == cap && ht1.contains(to_string(limit + 99));
+        OUTSTREAM << "  size " << ht1.size() << ", capacity " << ht1.capacity() << ", evictions "
+                  << ht1.stats().evictions << endl;
+        ok &= ht1.contains("keep") && ht1.stats().evictions >= 100;
+
+        OUTSTREAM << "Expiring a key right away..." << endl;
+        size_t before = ht1.size();
+        ok &= ht1.expireAfter("keep", 0) && !ht1.contains("keep") && !ht1.get("keep").has_value();
+        ok &= ht1.find("keep") == ht1.end() && !ht1.expireAfter("missing", 0);
+        ok &= ht1.insert("keep", 2) && ht1.get("keep") == 2u && ht1.size() == before;
+        ok &= ht1.expireAfter("keep", UINT32_MAX) && ht1.get("keep") == 2u;
+        ok &= ht1.expireAfter("keep", 3600) && ht1.get("keep") == 2u;
+        ok &= ht1.stats().expirations == 1;
+        // Expiry times go to disk as wall clock seconds and come back on this process's clock
+        uint32_t later = HashTable::nowSeconds() + 100;
+        uint32_t back = HashTable::localExpiry(HashTable::wallExpiry(later));
+        ok &= back + 1 >= later && back <= later + 1 && HashTable::wallExpiry(0) == 0;
+        ok &= HashTable::localExpiry(0) == 0 && HashTable::localExpiry(1) <= HashTable::nowSeconds();
+        OUTSTREAM << "  expirations " << ht1.stats().expirations << endl;
+
+        OUTSTREAM << "Walking, printing, saving and freezing a table with an expired key..." << endl;
+        HashTable ht2;
+        ht2.insert("a", 1);
+        ht2.insert("b", 2);
+        ht2.insert("c", 3);
+        ht2.expireAfter("a", 0);
+        size_t walked = 0;
+        for (auto [key, value] : ht2)
+            walked += (key != "a");
+        ok &= walked == 2 && distance(ht2.begin(), ht2.end()) == 2 && ht2.keys().size() == 2;
+        ok &= ht2.parallel_reduce<size_t>(0, [](const string&, size_t) { return size_t(1); }, plus<size_t>()) == 2;
+        // size() leaves the expired key out even before anything reaps it
+        ok &= ht2.size() == 2;
+        ostringstream printed;
+        printed << ht2;
+        ok &= printed.str().find("<a,") == string::npos && printed.str().find("<b, 2>") != string::npos;
+        FrozenHashTable frozen = ht2.freeze();
+        ok &= frozen.size() == 2 && !frozen.contains("a") && frozen.get("c") == 3u;
+        ht2.expireAfter("c", 3600);
+        ok &= ht2.saveSnapshot("ht_ttl_snapshot.bin");
+        optional<HashTable> loaded = HashTable::loadSnapshot("ht_ttl_snapshot.bin");
+        ok &= loaded && loaded->size() == 2 && !loaded->contains("a") && loaded->get("b") == 2u;
+        // The TTL comes back with the key instead of it becoming permanent
+        ok &= loaded && loaded->table[loaded->locate("c")].expiry >= HashTable::nowSeconds() + 3590;
+        ok &= loaded && loaded->table[loaded->locate("b")].expiry == 0;
+        MappedHashTable mappedTtl;
+        ok &= mappedTtl.open("ht_ttl_snapshot.bin") && mappedTtl.get("c") == 3u;
+        ok &= mappedTtl.find("c") && mappedTtl.find("c")->expiresAt >= HashTable::wallSeconds() + 3590;
+        mappedTtl.close();
+        // Once the saved expiry time has passed the mapping stops seeing the key
+        ifstream ttlIn("ht_ttl_snapshot.bin", ios::binary);
+        string ttlBytes((istreambuf_iterator<char>(ttlIn)), istreambuf_iterator<char>());
+        ttlIn.close();
+        SnapshotHeader ttlHeader{};
+        memcpy(&ttlHeader, ttlBytes.data(), sizeof(ttlHeader));
+        for (size_t i = 0; i < ttlHeader.capacity; i++) {
+            size_t at = ttlHeader.bucketsPos + i * sizeof(SnapshotBucket) + offsetof(SnapshotBucket, expiresAt);
+            uint64_t expiresAt;
+            memcpy(&expiresAt, ttlBytes.data() + at, sizeof(expiresAt));
+            if (expiresAt != 0) {
+                expiresAt = 1;
+                memcpy(ttlBytes.data() + at, &expiresAt, sizeof(expiresAt));
+            }
+        }
+        ofstream ttlOut("ht_ttl_snapshot.bin", ios::binary | ios::trunc);
+        ttlOut.write(ttlBytes.data(), static_cast<streamsize>(ttlBytes.size()));
+        ttlOut.close();
+        ok &= mappedTtl.open("ht_ttl_snapshot.bin") && !mappedTtl.contains("c") && mappedTtl.get("b") == 2u;
+        mappedTtl.close();
+        loaded = HashTable::loadSnapshot("ht_ttl_snapshot.bin");
+        ok &= loaded && !loaded->contains("c") && loaded->size() == 1;
+        std::remove("ht_ttl_snapshot.bin");
+        ht2.expireAfter("b", 3600);
+        ht2.purge();
+        ok &= ht2.size() == 2 && ht2.keys().size() == 2 && ht2.remove("b") && ht2.size() == 1;
+
+        OUTSTREAM << "Turning the limit off and growing again..." << endl;
+        ht1.setCapacityLimit(0);
+        for (size_t i = 0; i < limit * 4; i++)
+            ht1.insert("grow" + to_string(i), i);
+        ok &= ht1.size() == before + limit * 4 && ht1.capacity() > cap && ht1.get("keep") == 2u;
+        OUTSTREAM << (ok ? "SUCCESS: bounded table evicted cold keys and expired keys disappeared."
+                         : "FAILURE: bounded table or expiry did not behave correctly.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST TTL ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // MULTIMAP MODE
+    // =====================================================================
+    OUTSTREAM << "Testing MultiHashTable" << endl;
+    OUTSTREAM << "----------------------" << endl << endl;
+#ifdef HT_MULTIMAP
+    try {
+        MultiHashTable index;
+        vector<string> docs = {"the cat sat", "the dog sat", "a cat and a dog", "the end"};
+
+        OUTSTREAM << "Building an inverted index over " << docs.size() << " documents..." << endl;
+        for (size_t d = 0; d < docs.size(); d++) {
+            istringstream words(docs[d]);
+            string word;
+            while (words >> word)
+                index.insert(word, d);
+        }
+        bool ok = index.size() == 7 && index.valueCount() == 13;
+        ok &= index.count("the") == 3 && index.count("a") == 2 && index.count("bird") == 0;
+
+        OUTSTREAM << "Reading every posting for a key in one lookup..." << endl;
+        span<const size_t> the = index.get_all("the");
+        ok &= vector<size_t>(the.begin(), the.end()) == vector<size_t>{0, 1, 3};
+        auto [first, last] = index.equal_range("cat");
+        ok &= vector<size_t>(first, last) == vector<size_t>{0, 2};
+        auto [none, noneEnd] = index.equal_range("bird");
+        ok &= none == noneEnd && index.get_all("bird").empty();
+        OUTSTREAM << "  the ->";
+        for (size_t d : the)
+            OUTSTREAM << " " << d;
+        OUTSTREAM << endl;
+
+        OUTSTREAM << "Adding in bulk and removing values..." << endl;
+        ok &= index.insertAll("dog", {7, 8}) == 4 && index.valueCount() == 15;
+        ok &= index.insertAll("bird", {}) == 0 && !index.contains("bird") && index.insertAll("dog", {}) == 4;
+        ok &= index.removeValue("a", 2) && index.count("a") == 1 && !index.removeValue("a", 9);
+        ok &= index.removeValue("a", 2) && !index.contains("a") && index.size() == 6;
+        ok &= index.remove("dog") == 4 && !index.contains("dog") && index.valueCount() == 9;
+        OUTSTREAM << (ok ? "SUCCESS: multimap kept every value per key and returned them together."
+                         : "FAILURE: multimap values were wrong.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST MULTIMAP ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // ORDERED INDEX (RANGE AND PREFIX)
+    // =====================================================================
+    OUTSTREAM << "Testing enableOrderedIndex(), range() and prefix()" << endl;
+    OUTSTREAM << "--------------------------------------------------" << endl << endl;
+#ifdef HT_ORDERED
+    try {
+        HashTable ht1;
+        ht1.insert("pear", 1);
+        ht1.enableOrderedIndex();
+        const size_t count = MAXHASH * 32;
+
+        OUTSTREAM << "Inserting " << count << " keys with the index on, so the table resizes..." << endl;
+        for (size_t i = 0; i < count; i++)
+            ht1.insert("k" + to_string(1000 + i), i);
+        ht1.insert("apple", 2);
+        ht1.insert("kiwi", 3);
+        auto keysOf = [](const vector<HashTable::const_iterator>& its) {
+            vector<string> keys;
+            for (const auto& it : its)
+                keys.push_back(it.key());
+            return keys;
+        };
+
+        OUTSTREAM << "Querying a range and a prefix..." << endl;
+        bool ok = keysOf(ht1.range("k1000", "k1003")) == vector<string>{"k1000", "k1001", "k1002"};
+        ok &= keysOf(ht1.range("a", "l")).size() == count + 2;
+        ok &= keysOf(ht1.prefix("k10")).size() == 100 && keysOf(ht1.prefix("ki")) == vector<string>{"kiwi"};
+        ok &= ht1.prefix("zebra").empty() && ht1.range("b", "a").empty();
+        vector<string> all = keysOf(ht1.range("", "zzz"));
+        ok &= is_sorted(all.begin(), all.end()) && all.size() == ht1.size();
+        ok &= ht1.prefix("k1010")[0].value() == 10;
+        OUTSTREAM << "  first three keys: " << all[0] << " " << all[1] << " " << all[2] << endl;
+
+        OUTSTREAM << "Removing keys and erasing with erase_if..." << endl;
+        ht1.remove("kiwi");
+        ht1.remove("k1001");
+        ht1.erase_if([](const string& key, const size_t&) { return key.starts_with("k11"); });
+        ht1.insert("kiwi", 4);
+        ok &= keysOf(ht1.range("k1000", "k1003")) == vector<string>{"k1000", "k1002"};
+        ok &= ht1.prefix("k11").empty() && ht1.prefix("kiwi")[0].value() == 4;
+        all = keysOf(ht1.range("", "zzz"));
+        ok &= is_sorted(all.begin(), all.end()) && all.size() == ht1.size();
+
+        OUTSTREAM << "Mixing removes, inserts and queries so the index changes one key at a time..." << endl;
+        for (size_t i = 0; i < count; i += 7) {
+            ht1.remove("k" + to_string(1000 + i));
+            ht1.insert("m" + to_string(1000 + i), i);
+            if (i % 91 == 0)
+                ok &= keysOf(ht1.prefix("m")).size() == i / 7 + 1;
+        }
+        all = keysOf(ht1.range("", "zzz"));
+        ok &= is_sorted(all.begin(), all.end()) && all.size() == ht1.size();
+        ok &= adjacent_find(all.begin(), all.end()) == all.end();
+        ok &= ht1.prefix("k1007").empty() && ht1.prefix("m1007")[0].value() == 7;
+
+        ht1.disableOrderedIndex();
+        bool threw = false;
+        try {
+            ht1.prefix("k");
+        } catch (exception&) {
+            threw = true;
+        }
+        ok &= threw;
+        OUTSTREAM << (ok ? "SUCCESS: ordered index answered range and prefix queries in key order."
+                         : "FAILURE: ordered index returned the wrong keys.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST ORDERED INDEX ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // COMPILE TIME STATIC TABLE
+    // =====================================================================
+    OUTSTREAM << "Testing StaticHashTable" << endl;
+    OUTSTREAM << "-----------------------" << endl << endl;
+#ifdef HT_STATIC
+    try {
+        static constexpr auto commands = makeStaticHashTable({
+            {"get", 1}, {"set", 2}, {"del", 3}, {"list", 4}, {"help", 5},
+            {"quit", 6}, {"save", 7}, {"load", 8}, {"stats", 9}, {"flush", 10},
+        });
+        // All of these are checked by the compiler, not at run time
+        static_assert(commands.get("stats") == 9u && !commands.contains("nope"));
+        static_assert(commands.size() == 10 && commands.capacity() == 32 && commands.maxProbe() <= 2);
+
+        OUTSTREAM << "Looking up every command with run time keys..." << endl;
+        vector<string> names = {"get", "set", "del", "list", "help", "quit", "save", "load", "stats", "flush"};
+        bool ok = true;
+        for (size_t i = 0; i < names.size(); i++)
+            ok &= commands.get(names[i]) == i + 1 && commands.contains(names[i]);
+        ok &= !commands.get("gets").has_value() && !commands.contains("") && !commands.contains("Get");
+        OUTSTREAM << "  capacity " << commands.capacity() << ", longest probe " << commands.maxProbe()
+                  << ", seed " << commands.seed << endl;
+        OUTSTREAM << (ok ? "SUCCESS: static table was laid out at compile time and found every key."
+                         : "FAILURE: static table lookups were wrong.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST STATIC TABLE ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // FIXED CAPACITY TABLE
+    // =====================================================================
+    OUTSTREAM << "Testing FixedHashTable" << endl;
+    OUTSTREAM << "----------------------" << endl << endl;
+#ifdef HT_FIXED
+    try {
+        using Fixed = FixedHashTable<MAXHASH * 2, 8>;
+        static_assert(noexcept(declval<Fixed&>().insert("k", 1)) && noexcept(declval<const Fixed&>().get("k")));
+        auto ht1 = make_unique<Fixed>();
+
+        const size_t most = Fixed::maxFilled;
+        OUTSTREAM << "Filling " << most << " of " << ht1->capacity() << " buckets..." << endl;
+        bool ok = most == MAXHASH * 2 * 3 / 4;
+        for (size_t i = 0; i < most; i++)
+            ok &= ht1->insert("key" + to_string(i), i) == FixedInsert::INSERTED;
+        ok &= ht1->full() && ht1->size() == most && ht1->capacity() == MAXHASH * 2;
+
+        OUTSTREAM << "Inserting into the full table..." << endl;
+        FixedInsert result = ht1->insert("extra", 99);
+        ok &= result == FixedInsert::FULL && ht1->capacity() == MAXHASH * 2;
+        ok &= ht1->insert("key3", 7) == FixedInsert::EXISTS && ht1->get("key3") == 3u;
+        ok &= ht1->insert("much too long", 1) == FixedInsert::KEY_TOO_LONG && !ht1->contains("much too long");
+        OUTSTREAM << "  insert(extra) -> " << (result == FixedInsert::FULL ? "FULL" : "not FULL") << endl;
+
+        OUTSTREAM << "Removing a key and reusing its bucket..." << endl;
+        ok &= ht1->remove("key5") && !ht1->remove("key5") && !ht1->contains("key5");
+        ok &= ht1->insert("extra", 99) == FixedInsert::INSERTED && ht1->get("extra") == 99u;
+        ok &= ht1->insert_or_assign("extra", 100) == FixedInsert::EXISTS && ht1->get("extra") == 100u;
+        for (size_t i = 0; i < most; i++)
+            ok &= (i == 5) || ht1->get("key" + to_string(i)) == i;
+
+        OUTSTREAM << "Churning removes and inserts so tombstones pile up..." << endl;
+        using Churned = FixedHashTable<256, 8>;
+        auto ht2 = make_unique<Churned>();
+        for (size_t i = 0; i < Churned::maxFilled; i++)
+            ok &= ht2->insert("c" + to_string(i), i) == FixedInsert::INSERTED;
+        size_t next = Churned::maxFilled;
+        for (size_t round = 0; round < 256 * 16; round++, next++) {
+            ok &= ht2->remove("c" + to_string(next - Churned::maxFilled));
+            ok &= ht2->insert("c" + to_string(next), next) == FixedInsert::INSERTED;
+            ok &= ht2->size() + ht2->tombstones <= Churned::maxUsed;
+        }
+        // A miss stops at the first ESS bucket, so there have to be plenty of them left
+        size_t open = 0;
+        for (const auto& slot : ht2->table)
+            open += slot.type == fixedType::ESS;
+        ok &= open >= 256 - Churned::maxUsed && !ht2->contains("never there");
+        for (size_t i = next - Churned::maxFilled; i < next; i++)
+            ok &= ht2->get("c" + to_string(i)) == i;
+        OUTSTREAM << "  " << ht2->size() << " keys, " << ht2->tombstones << " tombstones, " << open
+                  << " ESS buckets after churn" << endl;
+        ht1->clear();
+        ok &= ht1->size() == 0 && !ht1->contains("key0") && ht1->insert("key0", 0) == FixedInsert::INSERTED;
+        OUTSTREAM << (ok ? "SUCCESS: fixed table reported FULL instead of growing."
+                         : "FAILURE: fixed table did not behave correctly.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST FIXED TABLE ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // COPY-ON-WRITE SNAPSHOTS
+    // =====================================================================
+    OUTSTREAM << "Testing VersionedHashTable::snapshot()" << endl;
+    OUTSTREAM << "--------------------------------------" << endl << endl;
+#ifdef HT_VERSIONED
+    try {
+        VersionedHashTable ht1;
+        const size_t count = MAXHASH * 64;
+        for (size_t i = 0; i < count; i++)
+            ht1.insert(to_string(i), i);
+        size_t pageCount = ht1.pages->size();
+
+        OUTSTREAM << "Taking a snapshot of " << count << " keys in " << pageCount << " pages..." << endl;
+        VersionedHashTable before = ht1.snapshot();
+        bool ok = before.sharedPages() == pageCount && ht1.copiedPages == 0;
+
+        OUTSTREAM << "Writing to the table while a reader scans the snapshot..." << endl;
+        bool readerOk = true;
+        thread reader([&before, &readerOk, count]() {
+            for (size_t r = 0; r < 20; r++)
+                for (size_t i = 0; i < count; i++)
+                    readerOk &= before.get(to_string(i)) == i;
+        });
+        ht1.insert_or_assign("3", 300);
+        ht1.remove("4");
+        ht1.insert("new", 1);
+        reader.join();
+        ok &= readerOk;
+        OUTSTREAM << "  pages copied by the writer: " << ht1.copiedPages << " of " << pageCount << endl;
+        ok &= ht1.copiedPages <= 3 && ht1.sharedPages() >= pageCount - 3;
+
+        ok &= before.get("3") == 3u && before.contains("4") && !before.contains("new") && before.size() == count;
+        ok &= ht1.get("3") == 300u && !ht1.contains("4") && ht1.contains("new") && ht1.size() == count;
+
+        OUTSTREAM << "Growing the table and exporting the snapshot..." << endl;
+        for (size_t i = count; i < count * 2; i++)
+            ht1.insert(to_string(i), i);
+        HashTable exported = before.toHashTable();
+        ok &= exported.size() == count && exported.get("3") == 3u && !before.contains(to_string(count));
+        ok &= ht1.size() == count * 2 && ht1.get(to_string(count * 2 - 1)) == count * 2 - 1;
+        OUTSTREAM << (ok ? "SUCCESS: snapshot stayed consistent and only touched pages were copied."
+                         : "FAILURE: snapshot saw later writes or copied too much.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST VERSIONED TABLE ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // WRITE-AHEAD LOG AND RECOVERY
+    // =====================================================================
+    OUTSTREAM << "Testing DurableHashTable" << endl;
+    OUTSTREAM << "------------------------" << endl << endl;
+#ifdef HT_DURABLE
+    try {
+        const string path = "ht_durable_test";
+        std::remove((path + ".snap").c_str());
+        std::remove((path + ".log").c_str());
+        const size_t count = MAXHASH * 64;
+        bool ok = true;
+        {
+            DurableHashTable ht1;
+            ok &= ht1.open(path, 64);
+
+            OUTSTREAM << "Logging " << count << " inserts in groups of 64..." << endl;
+            for (size_t i = 0; i < count; i++)
+                ht1.insert(to_string(i), i);
+            ht1.insert_or_assign("7", 700);
+            ht1.remove("8");
+            ok &= ht1.commit();
+            OUTSTREAM << "  " << ht1.syncs << " syncs for " << count + 2 << " operations" << endl;
+            ok &= ht1.syncs <= count / 64 + 1;
+
+            OUTSTREAM << "Compacting, then logging more and crashing before the next commit..." << endl;
+            ok &= ht1.compact() && ht1.logBytes == 0;
+            ht1.insert("after", 1);
+            ht1.remove("9");
+            ok &= ht1.commit();
+            ht1.insert("lost", 2);
+            // A crash here: recover from what's on disk while ht1 still holds "lost" in memory
+            DurableHashTable recovered;
+            ok &= recovered.open(path) && recovered.replayed == 2;
+            ok &= recovered.size() == count - 1 && recovered.get("7") == 700u && !recovered.contains("8");
+            ok &= !recovered.contains("9") && recovered.get("after") == 1u && !recovered.contains("lost");
+            recovered.close();
+            ht1.pending.clear();
+            ht1.pendingOps = 0;
+        }
+
+        OUTSTREAM << "Recovering with a torn record at the end of the log..." << endl;
+        {
+            FILE* log = fopen((path + ".log").c_str(), "ab");
+            string torn(40, 'x');
+            fwrite(torn.data(), 1, torn.size(), log);
+            fclose(log);
+        }
+        DurableHashTable ht2;
+        ok &= ht2.open(path) && ht2.replayed == 2 && ht2.logBytes < 100 && ht2.size() == count - 1;
+        ok &= ht2.insert("next", 3) && ht2.commit();
+        ht2.close();
+        ok &= ht2.open(path) && ht2.get("next") == 3u && ht2.replayed == 3;
+
+        OUTSTREAM << "Logging TTLs and recovering them..." << endl;
+        ok &= ht2.expireAfter("next", 3600) && ht2.expireAfter("after", 0) && !ht2.expireAfter("missing", 5);
+        ht2.close();
+        ok &= ht2.open(path) && ht2.get("next") == 3u && !ht2.contains("after") && ht2.replayed == 5;
+        ok &= ht2.table.table[ht2.table.locate("next")].expiry >= HashTable::nowSeconds() + 3590;
+        // Compacting writes the TTL into the snapshot instead
+        ok &= ht2.compact();
+        ht2.close();
+        ok &= ht2.open(path) && ht2.replayed == 0 && ht2.get("next") == 3u && !ht2.contains("after");
+        ok &= ht2.table.table[ht2.table.locate("next")].expiry >= HashTable::nowSeconds() + 3590;
+        ht2.close();
+        std::remove((path + ".snap").c_str());
+        std::remove((path + ".log").c_str());
+        OUTSTREAM << (ok ? "SUCCESS: log replayed over the snapshot and the torn tail was dropped."
+                         : "FAILURE: recovered table did not match what was committed.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST DURABLE TABLE ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // TIERED TABLE SPILLING TO DISK
+    // =====================================================================
+    OUTSTREAM << "Testing TieredHashTable" << endl;
+    OUTSTREAM << "-----------------------" << endl << endl;
+#ifdef HT_TIERED
+    try {
+        TieredHashTable ht1;
+        const string path = "ht_tiered_test.spill";
+        bool ok = ht1.open(path, 16, 2);
+        const size_t count = MAXHASH * 256;
+
+        OUTSTREAM << "Inserting " << count << " keys with only 2 of 16 segments in memory..." << endl;
+        for (size_t i = 0; i < count; i++)
+            ok &= ht1.insert(to_string(i), i);
+        ok &= ht1.size() == count && ht1.residentSegments() <= 2 && !ht1.insert("5", 5);
+        OUTSTREAM << "  " << ht1.evictions << " evictions, " << ht1.pageIns << " page ins" << endl;
+
+        OUTSTREAM << "Reading everything back one key at a time and in a batch..." << endl;
+        for (size_t i = 0; i < count; i += 7)
+            ok &= ht1.get(to_string(i)) == i;
+        ok &= ht1.remove("10") && !ht1.remove("10") && !ht1.contains("10");
+        vector<string> batch;
+        for (size_t i = 0; i < count; i++)
+            batch.push_back(to_string(count - 1 - i));
+        batch.push_back("missing");
+        size_t pageInsBefore = ht1.pageIns;
+        vector<optional<size_t>> found = ht1.getBatch(batch);
+        for (size_t i = 0; i < count; i++)
+            ok &= (count - 1 - i == 10) ? !found[i].has_value() : found[i] == count - 1 - i;
+        ok &= !found[count].has_value() && ht1.residentSegments() <= 2;
+        OUTSTREAM << "  batch of " << batch.size() << " keys paged in " << ht1.pageIns - pageInsBefore
+                  << " segments" << endl;
+        ok &= ht1.pageIns - pageInsBefore <= 16;
+
+        OUTSTREAM << "Swapping every key for a new one, 8 times over..." << endl;
+        // Segments keep outgrowing their space, the free list has to keep the file from growing
+        size_t liveBytes = 0;
+        for (size_t round = 1; round <= 8; round++) {
+            for (size_t i = 0; i < count; i++) {
+                ht1.remove(to_string((round - 1) * count + i));
+                ok &= ht1.insert(to_string(round * count + i), i);
+            }
+        }
+        for (size_t i = 0; i < count; i++)
+            liveBytes += sizeof(uint32_t) + sizeof(uint64_t) + to_string(8 * count + i).size();
+        ok &= ht1.size() == count && ht1.get(to_string(8 * count + 3)) == 3 && !ht1.contains("3");
+        OUTSTREAM << "  spill file is " << ht1.fileEnd << " bytes for " << liveBytes << " bytes of pairs" << endl;
+        ok &= ht1.fileEnd <= 2 * liveBytes;
+        ht1.close();
+        FILE* gone = fopen(path.c_str(), "rb");
+        ok &= gone == nullptr;
+        OUTSTREAM << (ok ? "SUCCESS: tiered table kept cold segments on disk and found every key."
+                         : "FAILURE: tiered table lost keys or kept too much in memory.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST TIERED TABLE ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // EXTENDIBLE HASHING
+    // =====================================================================
+    OUTSTREAM << "Testing ExtendibleHashTable" << endl;
+    OUTSTREAM << "---------------------------" << endl << endl;
+#ifdef HT_EXTENDIBLE
+    try {
+        ExtendibleHashTable ht1(64);
+        const size_t count = MAXHASH * 512;
+
+        OUTSTREAM << "Inserting " << count << " keys into 64 bucket segments..." << endl;
+        bool ok = true;
+        size_t lastSegments = 1;
+        for (size_t i = 0; i < count; i++) {
+            ok &= ht1.insert(to_string(i), i);
+            // Each insert adds at most a few segments, never a whole new table
+            ok &= ht1.segmentCount() <= lastSegments + 2;
+            lastSegments = ht1.segmentCount();
+        }
+        ok &= ht1.size() == count && !ht1.insert("3", 3) && ht1.splits == ht1.segmentCount() - 1;
+        ok &= ht1.directory.size() == (size_t{1} << ht1.globalDepth) && ht1.alpha() > 0.25;
+        OUTSTREAM << "  " << ht1.segmentCount() << " segments, directory of " << ht1.directory.size()
+                  << ", load " << ht1.alpha() << endl;
+
+        OUTSTREAM << "Checking every key, then removing and reinserting half of them..." << endl;
+        for (size_t i = 0; i < count; i++)
+            ok &= ht1.get(to_string(i)) == i;
+        for (size_t i = 0; i < count; i += 2)
+            ok &= ht1.remove(to_string(i));
+        ok &= ht1.size() == count / 2 && !ht1.contains("0") && ht1.contains("1");
+        for (size_t i = 0; i < count; i += 2)
+            ok &= ht1.insert(to_string(i), i + 1);
+        ht1["1"] = 100;
+        for (size_t i = 0; i < count; i++)
+            ok &= ht1.get(to_string(i)) == (i == 1 ? 100 : (i % 2 == 0 ? i + 1 : i));
+        ok &= ht1.keys().size() == count;
+        OUTSTREAM << (ok ? "SUCCESS: table grew one segment at a time and kept every key."
+                         : "FAILURE: extendible table lost keys or grew too much at once.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST EXTENDIBLE TABLE ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // NUMA SHARDED TABLE
+    // =====================================================================
+    OUTSTREAM << "Testing ShardedHashTable on a simulated 2 node topology" << endl;
+    OUTSTREAM << "-------------------------------------------------------" << endl << endl;
+#ifdef HT_NUMA
+    try {
+        bool ok = NumaTopology::parseCpuList("0-3,8,10-11") == vector<int>{0, 1, 2, 3, 8, 10, 11};
+        ok &= NumaTopology::detect().nodeCount() >= 1;
+        ShardedHashTable ht1(NumaTopology::simulated(2, 2), 4);
+        ok &= ht1.shards.size() == 8 && ht1.localShards(1) == vector<size_t>{4, 5, 6, 7};
+        for (size_t s = 0; s < ht1.shards.size(); s++)
+            ok &= ht1.shards[s]->node == ht1.nodeOfShard(s);
+        const size_t count = MAXHASH * 128;
+
+        OUTSTREAM << "Inserting " << count << " keys as one batch routed to each node..." << endl;
+        vector<ShardOp> batch;
+        for (size_t i = 0; i < count; i++)
+            batch.push_back(ShardOp{ShardOpType::INSERT, to_string(i), i, nullopt, false});
+        ht1.runBatch(batch);
+        for (const ShardOp& op : batch)
+            ok &= op.ok;
+        ok &= ht1.size() == count && ht1.remoteOps == 0 && ht1.localOps == count;
+        OUTSTREAM << "  local " << ht1.localOps << ", remote " << ht1.remoteOps << endl;
+
+        OUTSTREAM << "Looking keys up in a batch and directly from an unpinned thread..." << endl;
+        vector<ShardOp> lookups;
+        for (size_t i = 0; i < count; i += 3)
+            lookups.push_back(ShardOp{ShardOpType::GET, to_string(i), 0, nullopt, false});
+        lookups.push_back(ShardOp{ShardOpType::GET, "missing", 0, nullopt, false});
+        ht1.runBatch(lookups);
+        for (size_t j = 0; j + 1 < lookups.size(); j++)
+            ok &= lookups[j].result == j * 3;
+        ok &= !lookups.back().ok && ht1.remoteOps == 0;
+        ok &= ht1.get("5") == 5u && ht1.remove("5") && !ht1.contains("5") && !ht1.insert("6", 6);
+        ok &= ht1.localOps + ht1.remoteOps == count + lookups.size() + 4 && ht1.size() == count - 1;
+
+        OUTSTREAM << "Growing shards with direct inserts from an unpinned thread..." << endl;
+        size_t grownBefore = ht1.routedGrowths;
+        for (size_t i = count; i < count * 4; i++)
+            ok &= ht1.insert(to_string(i), i);
+        OUTSTREAM << "  growths handed to a node's worker: " << ht1.routedGrowths - grownBefore << endl;
+        ok &= ht1.routedGrowths > grownBefore && ht1.size() == count * 4 - 1 && ht1.get(to_string(count * 3)) == count * 3;
+        OUTSTREAM << (ok ? "SUCCESS: batches ran on each shard's own node and found every key."
+                         : "FAILURE: sharded table routed or stored keys wrongly.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST NUMA SHARDS ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // HUGE PAGE BACKED STORAGE
+    // =====================================================================
+    OUTSTREAM << "Testing setPageMode()" << endl;
+    OUTSTREAM << "---------------------" << endl << endl;
+#ifdef HT_HUGE_PAGES
+    try {
+        HashTable ht1(MAXHASH * 8192);
+        const size_t count = MAXHASH * 512;
+        for (size_t i = 0; i < count; i++)
+            ht1.insert(to_string(i), i);
+        bool ok = ht1.stats().bucketBacking == PageBacking::HEAP;
+
+        OUTSTREAM << "Moving a " << ht1.capacity() << " bucket table to transparent huge pages..." << endl;
+        ht1.setPageMode(PageMode::TRANSPARENT);
+        HashTableStats stats = ht1.stats();
+        OUTSTREAM << "  buckets: " << pageBackingName(stats.bucketBacking) << ", offsets: "
+                  << pageBackingName(stats.offsetBacking) << endl;
+        ok &= stats.bucketBacking == PageBacking::TRANSPARENT_HUGE || stats.bucketBacking == PageBacking::MMAP;
+        ok &= stats.offsetBacking != PageBacking::HUGETLB;
+
+        OUTSTREAM << "Asking for hugetlbfs pages, falling back if none are reserved..." << endl;
+        ht1.setPageMode(PageMode::HUGETLB);
+        stats = ht1.stats();
+        OUTSTREAM << "  buckets: " << pageBackingName(stats.bucketBacking) << endl;
+        ok &= stats.bucketBacking != PageBacking::HEAP;
+        for (size_t i = count; i < count * 4; i++)
+            ht1.insert(to_string(i), i);
+        ok &= ht1.stats().bucketBacking != PageBacking::HEAP && ht1.size() == count * 4;
+        HashTable copy = ht1;
+        ok &= copy.stats().bucketBacking != PageBacking::HEAP && copy.get("7") == 7u;
+        for (size_t i = 0; i < count * 4; i++)
+            ok &= ht1.get(to_string(i)) == i;
+
+        OUTSTREAM << "Back to the heap, and a small table stays on the heap..." << endl;
+        ht1.setPageMode(PageMode::DEFAULT);
+        ok &= ht1.stats().bucketBacking == PageBacking::HEAP && ht1.get("12") == 12u;
+        HashTable small;
+        small.setPageMode(PageMode::TRANSPARENT);
+        small.insert("a", 1);
+        ok &= small.stats().bucketBacking == PageBacking::HEAP && small.get("a") == 1u;
+        OUTSTREAM << (ok ? "SUCCESS: table moved between page backings and kept every key."
+                         : "FAILURE: page backing was wrong or keys were lost.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST HUGE PAGES ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // ASYNC BATCHED LOOKUPS
+    // =====================================================================
+    OUTSTREAM << "Testing async_get() and run()" << endl;
+    OUTSTREAM << "-----------------------------" << endl << endl;
+#ifdef HT_ASYNC
+    try {
+        HashTable ht1;
+        const size_t count = MAXHASH * 256;
+        // Each key points at another key, so a walk needs one lookup per hop
+        for (size_t i = 0; i < count; i++)
+            ht1.insert(to_string(i), (i * 7 + 3) % count);
+        AsyncHashTable async(ht1, 8);
+
+        OUTSTREAM << "Starting " << count << " coroutines that each follow 5 hops..." << endl;
+        auto walk = [](AsyncHashTable& table, size_t start, size_t* out) -> LookupTask {
+            size_t at = start;
+            for (int hop = 0; hop < 5; hop++) {
+                optional<size_t> next = co_await table.async_get(to_string(at));
+                if (!next) {
+                    *out = SIZE_MAX;
+                    co_return;
+                }
+                at = *next;
+            }
+            *out = at;
+        };
+        vector<size_t> results(count, 0);
+        for (size_t i = 0; i < count; i++)
+            walk(async, i, &results[i]);
+        bool ok = async.pendingCount() == count;
+        size_t done = async.run();
+        OUTSTREAM << "  " << done << " lookups in " << async.groups << " prefetched groups" << endl;
+        ok &= done == count * 5 && async.pendingCount() == 0 && async.groups == count * 5 / 8;
+        for (size_t i = 0; i < count; i++) {
+            size_t at = i;
+            for (int hop = 0; hop < 5; hop++)
+                at = (at * 7 + 3) % count;
+            ok &= results[i] == at;
+        }
+
+        OUTSTREAM << "Looking up a missing key..." << endl;
+        size_t missing = 0;
+        walk(async, count + 1, &missing);
+        async.run();
+        ok &= missing == SIZE_MAX && async.lookups == count * 5 + 1;
+
+        OUTSTREAM << "Destroying a front-end with a coroutine still parked..." << endl;
+        auto hold = [](AsyncHashTable& table, shared_ptr<int> held) -> LookupTask {
+            co_await table.async_get("1");
+            (*held)++;
+        };
+        auto held = make_shared<int>(0);
+        {
+            AsyncHashTable parked(ht1);
+            hold(parked, held);
+            ok &= held.use_count() == 2 && parked.pendingCount() == 1;
+        }
+        ok &= held.use_count() == 1 && *held == 0;
+        OUTSTREAM << (ok ? "SUCCESS: every coroutine got the right values back from batched lookups."
+                         : "FAILURE: a coroutine got a wrong value or was never resumed.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST ASYNC LOOKUPS ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // MEMORY USAGE AND COMPACT MODE
+    // =====================================================================
+    OUTSTREAM << "Testing memory_usage() and CompactHashTable" << endl;
+    OUTSTREAM << "-------------------------------------------" << endl << endl;
+#ifdef HT_COMPACT
+    try {
+        HashTable ht1;
+        const size_t count = MAXHASH * 512;
+        size_t longKeyBytes = 0;
+        for (size_t i = 0; i < count; i++) {
+            // Half the keys are too long to fit inside a std::string
+            string key = (i % 2 == 0) ? to_string(i) : "session-token-" + to_string(i * 7919);
+            if (key.size() > string().capacity())
+                longKeyBytes += key.size() + 1;
+            ht1.insert(key, i);
+        }
+        HashTableMemory usage = ht1.memory_usage();
+        OUTSTREAM << "HashTable with " << usage.entries << " entries: " << usage.total() << " bytes, "
+                  << usage.bytesPerEntry() << " per entry" << endl;
+        OUTSTREAM << "  buckets " << usage.bucketBytes << ", metadata " << usage.metadataBytes << ", keys "
+                  << usage.keyBytes << ", side tables " << usage.sideTableBytes << ", slack " << usage.slackBytes << endl;
+        bool ok = usage.entries == count && usage.bucketBytes == ht1.capacity() * sizeof(HashTableBucket);
+        ok &= usage.keyBytes == longKeyBytes && usage.sideTableBytes == 0;
+        ht1.enableFilter();
+        ok &= ht1.memory_usage().sideTableBytes == ht1.filter.blocks.size() * sizeof(BloomBlock);
+
+        OUTSTREAM << "Copying it into a CompactHashTable..." << endl;
+        CompactHashTable compact(ht1);
+        HashTableMemory small = compact.memory_usage();
+        OUTSTREAM << "CompactHashTable: " << small.total() << " bytes, " << small.bytesPerEntry()
+                  << " per entry" << endl;
+        ok &= compact.size() == count && small.bytesPerEntry() * 3 < usage.bytesPerEntry();
+        for (const auto& [key, value] : ht1)
+            ok &= compact.get(key) == value;
+        ok &= !compact.contains("missing") && !compact.contains("") && !compact.insert("0", 5);
+
+        OUTSTREAM << "Short keys, removals and a value too big for 32 bits..." << endl;
+        ok &= compact.insert("", 1) && compact.insert("ab", 2) && compact.get("") == 1u && compact.get("ab") == 2u;
+        for (size_t i = 1; i < count; i += 2)
+            ok &= compact.remove("session-token-" + to_string(i * 7919));
+        ok &= compact.memory_usage().slackBytes > small.slackBytes;
+        for (size_t i = 0; i < count; i++)
+            compact.insert("replacement-key-" + to_string(i), 9);
+        ok &= compact.size() == count / 2 + 2 + count && compact.deadBytes == 0;
+        ok &= compact.get("replacement-key-3") == 9u && compact.get("4") == 4u && !compact.contains("session-token-7919");
+        ok &= compact.keys().size() == compact.size();
+        // A tiny arena lives inside the table object, so it adds nothing on top
+        CompactHashTable tiny;
+        tiny.insert("a-long-key-9", 1);
+        ok &= tiny.memory_usage().keyBytes == 0 && tiny.memory_usage().total() == tiny.memory_usage().bucketBytes + sizeof(CompactHashTable);
+        HashTable big;
+        big.insert("big", size_t(UINT32_MAX) + 1);
+        bool threw = false;
+        try {
+            CompactHashTable tooBig(big);
+        } catch (exception&) {
+            threw = true;
+        }
+        ok &= threw;
+        OUTSTREAM << (ok ? "SUCCESS: memory was accounted for and the compact table kept every pair."
+                         : "FAILURE: memory breakdown or compact table was wrong.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST COMPACT MODE ***" << endl << endl;
+#endif
+
     OUTSTREAM << "All tests complete." << endl;
     return 0;
 }
@@ -0,0 +1,149 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the cpp file for the HugePageAllocator class template. Every allocation starts with a
+* 64 byte header holding how it was made, so deallocate knows whether to munmap or delete and
+* pageBackingOf can report it, and the array itself stays 64 byte aligned. This file includes:
+* The hugePageAllocate function, the hugePageFree function, the pageBackingOf function, the
+* pageBytesOf function, the pageBackingName function, the transparentHugePagesOn function.
+* -----------------------------------------------------------------------------------------*/
+
+#include "HugePageAllocator.h"
+#include <fstream>
+#include <new>
+#include <string>
+#include <sys/mman.h>
+
+using namespace std;
+
+// Sits right before every array handed out
+struct alignas(64) PageHeader {
+    void* mapStart;
+    size_t mapBytes;
+    PageBacking backing;
+};
+
+/**
+* transparentHugePagesOn returns false if the kernel has transparent huge pages turned off
+* completely, in which case madvise can't get any. Only read once.
+*/
+
+static bool transparentHugePagesOn() {
+    static const bool on = []() {
+        ifstream in("/sys/kernel/mm/transparent_hugepage/enabled");
+        string setting;
+        getline(in, setting);
+        // No file means no THP support at all
+        return in.good() && setting.find("[never]") == string::npos;
+    }();
+    return on;
+}
+
+/**
+* hugePageAllocate returns bytes of 64 byte aligned memory, trying for the backing mode asks for
+* and falling back when the system doesn't have it. Throws bad_alloc if even the heap fails.
+*/
+
+void* hugePageAllocate(size_t bytes, PageMode mode) {
+    size_t total = bytes + sizeof(PageHeader);
+    PageHeader header{nullptr, 0, PageBacking::HEAP};
+    if (mode != PageMode::DEFAULT && bytes >= HUGE_PAGE_MIN_BYTES) {
+        size_t rounded = (total + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+        // Explicit huge pages need pages reserved in hugetlbfs, which often there aren't
+        if (mode == PageMode::HUGETLB) {
+            void* map = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (map != MAP_FAILED) {
+                header = PageHeader{map, rounded, PageBacking::HUGETLB};
+            }
+        }
+        // Transparent huge pages, mapped with an extra huge page so the start can be aligned
+        if (header.mapStart == nullptr) {
+            size_t padded = rounded + HUGE_PAGE_BYTES;
+            void* map = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (map != MAP_FAILED) {
+                auto start = reinterpret_cast<uintptr_t>(map);
+                uintptr_t aligned = (start + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+                // Give back the unaligned bits on either side
+                if (aligned > start) {
+                    munmap(map, aligned - start);
+                }
+                if (aligned + rounded < start + padded) {
+                    munmap(reinterpret_cast<void*>(aligned + rounded), start + padded - aligned - rounded);
+                }
+                void* mapStart = reinterpret_cast<void*>(aligned);
+                bool advised = transparentHugePagesOn() && madvise(mapStart, rounded, MADV_HUGEPAGE) == 0;
+                header = PageHeader{mapStart, rounded, advised ? PageBacking::TRANSPARENT_HUGE : PageBacking::MMAP};
+            }
+        }
+    }
+    char* memory;
+    if (header.mapStart != nullptr) {
+        memory = static_cast<char*>(header.mapStart);
+    } else {
+        // Normal heap memory, still 64 byte aligned
+        memory = static_cast<char*>(::operator new(total, align_val_t(alignof(PageHeader))));
+        header.mapStart = memory;
+        header.mapBytes = total;
+    }
+    new (memory) PageHeader(header);
+    return memory + sizeof(PageHeader);
+}
+
+/**
+* hugePageFree gives back memory from hugePageAllocate the same way it was gotten.
+*/
+
+void hugePageFree(void* p) {
+    if (p == nullptr) {
+        return;
+    }
+    auto* header = reinterpret_cast<PageHeader*>(static_cast<char*>(p) - sizeof(PageHeader));
+    if (header->backing == PageBacking::HEAP) {
+        ::operator delete(header->mapStart, align_val_t(alignof(PageHeader)));
+    } else {
+        munmap(header->mapStart, header->mapBytes);
+    }
+}
+
+/**
+* pageBackingOf returns what memory from hugePageAllocate is backed by. A null pointer (an empty
+* vector) counts as HEAP.
+*/
+
+PageBacking pageBackingOf(const void* p) {
+    if (p == nullptr) {
+        return PageBacking::HEAP;
+    }
+    return reinterpret_cast<const PageHeader*>(static_cast<const char*>(p) - sizeof(PageHeader))->backing;
+}
+
+/**
+* pageBytesOf returns how many bytes memory from hugePageAllocate really took, counting the header
+* and any rounding up to whole huge pages. A null pointer (an empty vector) took nothing.
+*/
+
+size_t pageBytesOf(const void* p) {
+    if (p == nullptr) {
+        return 0;
+    }
+    return reinterpret_cast<const PageHeader*>(static_cast<const char*>(p) - sizeof(PageHeader))->mapBytes;
+}
+
+/**
+* pageBackingName returns a backing as text, for printing stats.
+*/
+
+const char* pageBackingName(PageBacking backing) {
+    switch (backing) {
+        case PageBacking::HEAP:
+            return "heap";
+        case PageBacking::MMAP:
+            return "mmap";
+        case PageBacking::TRANSPARENT_HUGE:
+            return "transparent huge pages";
+        case PageBacking::HUGETLB:
+            return "hugetlbfs";
+    }
+    return "unknown";
+}
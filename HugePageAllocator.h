@@ -0,0 +1,63 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the header file for the HugePageAllocator class template. It's a standard allocator for
+* HashTable's bucket and offset vectors that can put big arrays in huge pages, so random probes
+* across a large table take far fewer TLB misses. HUGETLB asks for explicit hugetlbfs pages,
+* TRANSPARENT maps the array 2 MiB aligned and madvises it for transparent huge pages, and each
+* falls back to the next one down (HUGETLB, then TRANSPARENT, then the normal heap) if the system
+* won't give it. Every allocation remembers what it actually got, which pageBackingOf reads back.
+* This file includes: The HugePageAllocator constructors, the allocate function, the deallocate
+* function, the == operator override, the hugePageAllocate function, the hugePageFree function,
+* the pageBackingOf function, the pageBytesOf function, the pageBackingName function.
+* -----------------------------------------------------------------------------------------*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+using namespace std;
+
+// enum types for what an allocator should try to get
+enum class PageMode : uint8_t {DEFAULT, TRANSPARENT, HUGETLB};
+
+// enum types for what an allocation actually got
+enum class PageBacking : uint8_t {HEAP, MMAP, TRANSPARENT_HUGE, HUGETLB};
+
+// Size of one huge page on x86-64 and most arm64 systems
+constexpr size_t HUGE_PAGE_BYTES = 2u << 20;
+// Arrays smaller than this stay on the heap, since a huge page would mostly go to waste
+constexpr size_t HUGE_PAGE_MIN_BYTES = 1u << 20;
+
+// Non-template halves of the allocator, in HugePageAllocator.cpp
+void* hugePageAllocate(size_t bytes, PageMode mode);
+void hugePageFree(void* p);
+PageBacking pageBackingOf(const void* p);
+size_t pageBytesOf(const void* p);
+const char* pageBackingName(PageBacking backing);
+
+template <typename T>
+class HugePageAllocator {
+    public:
+        using value_type = T;
+        // Tables with different modes own memory differently, so allocators move with their vector
+        using propagate_on_container_copy_assignment = true_type;
+        using propagate_on_container_move_assignment = true_type;
+        using propagate_on_container_swap = true_type;
+        using is_always_equal = false_type;
+        // HugePageAllocator variables
+        PageMode mode;
+        // HugePageAllocator constructor declarations
+        HugePageAllocator() noexcept : mode(PageMode::DEFAULT) {}
+        explicit HugePageAllocator(PageMode mode) noexcept : mode(mode) {}
+        template <typename U>
+        HugePageAllocator(const HugePageAllocator<U>& other) noexcept : mode(other.mode) {}
+        // HugePageAllocator function declarations
+        T* allocate(size_t n) { return static_cast<T*>(hugePageAllocate(n * sizeof(T), mode)); }
+        void deallocate(T* p, size_t) noexcept { hugePageFree(p); }
+        template <typename U>
+        bool operator==(const HugePageAllocator<U>& other) const noexcept { return mode == other.mode; }
+};
@@ -0,0 +1,161 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the cpp file for the MultiHashTable class. It contains the constructor and all the
+* function definitions. This file includes: The MultiHashTable constructor, the insert function,
+* the insertAll function, the count function, the equal_range function, the get_all function, the
+* contains function, the remove function, the removeValue function, the keys function, the size
+* function, the valueCount function.
+* -----------------------------------------------------------------------------------------*/
+
+#include "MultiHashTable.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+* The constructor takes an initial capacity for the underlying table, 8 if none is given.
+*/
+
+MultiHashTable::MultiHashTable(size_t cap) : runs(cap), valueTotal(0) {}
+
+/**
+* insert adds one more value for the key, even if the key already has that value, and returns how
+* many values the key has now. The key is probed once whether it's new or not.
+*/
+
+size_t MultiHashTable::insert(const std::string& key, size_t value) {
+    // Finds the key's run, or starts an empty one
+    vector<size_t>& run = runs.try_emplace(key).first.value();
+    run.push_back(value);
+    valueTotal++;
+    return run.size();
+}
+
+/**
+* insertAll adds every value in the vector to the key with one probe and at most one grow of the
+* key's run. Returns how many values the key has now. An empty vector doesn't add the key, so a
+* key that wasn't there still has 0 values and takes no bucket.
+*/
+
+size_t MultiHashTable::insertAll(const std::string& key, const vector<size_t>& values) {
+    // Nothing to add, don't leave an empty run behind
+    if (values.empty()) {
+        return count(key);
+    }
+    vector<size_t>& run = runs.try_emplace(key).first.value();
+    run.insert(run.end(), values.begin(), values.end());
+    valueTotal += values.size();
+    return run.size();
+}
+
+/**
+* count returns how many values the key has, 0 if it isn't in the table.
+*/
+
+size_t MultiHashTable::count(const std::string& key) const {
+    auto it = runs.find(key);
+    return it == runs.end() ? 0 : it.value().size();
+}
+
+/**
+* equal_range returns the first and one past the last of the key's values, in the order they were
+* inserted. Both are the same if the key isn't in the table. The iterators stay good until the
+* key gets another value or is removed.
+*/
+
+pair<MultiHashTable::value_iterator, MultiHashTable::value_iterator> MultiHashTable::equal_range(const std::string& key) const {
+    // Stands in for the run of a key that isn't there
+    static const vector<size_t> none;
+    auto it = runs.find(key);
+    const vector<size_t>& run = (it == runs.end()) ? none : it.value();
+    return {run.begin(), run.end()};
+}
+
+/**
+* get_all returns every value for the key as one view over its run, without copying them and
+* without probing again per value. The view is empty if the key isn't in the table.
+*/
+
+span<const size_t> MultiHashTable::get_all(const std::string& key) const {
+    auto it = runs.find(key);
+    // The key was not in the table, return an empty view
+    if (it == runs.end()) {
+        return {};
+    }
+    return it.value();
+}
+
+/**
+* contains returns true if the key has at least one value.
+*/
+
+bool MultiHashTable::contains(const std::string& key) const {
+    return runs.contains(key);
+}
+
+/**
+* remove takes the key and all of its values out of the table and returns how many values it had.
+*/
+
+size_t MultiHashTable::remove(const std::string& key) {
+    size_t removed = count(key);
+    if (runs.remove(key)) {
+        valueTotal -= removed;
+    }
+    return removed;
+}
+
+/**
+* removeValue takes out the first copy of value from the key's run, keeping the rest in order.
+* If that was the key's last value the key is removed too. Returns false if the key didn't have
+* that value.
+*/
+
+bool MultiHashTable::removeValue(const std::string& key, size_t value) {
+    auto it = runs.find(key);
+    // The key was not in the table
+    if (it == runs.end()) {
+        return false;
+    }
+    vector<size_t>& run = it.value();
+    auto pos = find(run.begin(), run.end(), value);
+    // The key doesn't have that value
+    if (pos == run.end()) {
+        return false;
+    }
+    run.erase(pos);
+    valueTotal--;
+    // No values left, so the key goes too
+    if (run.empty()) {
+        runs.remove(key);
+    }
+    return true;
+}
+
+/**
+* keys returns every key with at least one value, each key once.
+*/
+
+vector<std::string> MultiHashTable::keys() const {
+    return runs.keys();
+}
+
+/**
+* size returns how many different keys are in the table.
+*/
+
+size_t MultiHashTable::size() const {
+    return runs.size();
+}
+
+/**
+* valueCount returns how many values are in the table across every key.
+*/
+
+size_t MultiHashTable::valueCount() const {
+    return valueTotal;
+}
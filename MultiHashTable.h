@@ -0,0 +1,43 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the header file for the MultiHashTable class. A MultiHashTable is a string -> values
+* multimap: a key can be inserted any number of times, and all of a key's values are kept
+* together in one contiguous run so they can be read back with a single probe. This file
+* includes: The MultiHashTable constructor, the insert function, the insertAll function, the count
+* function, the equal_range function, the get_all function, the contains function, the remove
+* function, the removeValue function, the keys function, the size function, the valueCount
+* function.
+* -----------------------------------------------------------------------------------------*/
+#pragma once
+
+#include "HashTableImpl.h"
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+class MultiHashTable {
+    public:
+        using value_iterator = vector<size_t>::const_iterator;
+        // MultiHashTable variables
+        HashTable_t<std::string, vector<size_t>> runs;
+        size_t valueTotal;
+        // MultiHashTable constructor declaration
+        explicit MultiHashTable(size_t cap = 8);
+        // MultiHashTable function declarations
+        size_t insert(const std::string& key, size_t value);
+        size_t insertAll(const std::string& key, const vector<size_t>& values);
+        size_t count(const std::string& key) const;
+        pair<value_iterator, value_iterator> equal_range(const std::string& key) const;
+        span<const size_t> get_all(const std::string& key) const;
+        bool contains(const std::string& key) const;
+        size_t remove(const std::string& key);
+        bool removeValue(const std::string& key, size_t value);
+        vector<std::string> keys() const;
+        size_t size() const;
+        size_t valueCount() const;
+};
@@ -0,0 +1,436 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the cpp file for the NumaTopology and ShardedHashTable classes. It contains the
+* constructor and all the function definitions. Pinning uses sched_setaffinity, so this is Linux
+* only, and no NUMA library is needed. This file includes: The NumaTopology detect function, the
+* simulated function, the nodeCount function, the nodeOfCpu function, the parseCpuList function, the
+* ShardedHashTable constructor and destructor, the insert function, the remove function, the
+* contains function, the get function, the size function, the runBatch function, the shardFor
+* function, the nodeOfShard function, the localShards function, the currentNode function, the
+* pinToNode function, the countAccess function, the runOnNodes function, the workerLoop function,
+* the growLocally function.
+* -----------------------------------------------------------------------------------------*/
+
+#include "ShardedHashTable.h"
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sched.h>
+
+using namespace std;
+
+// The node the current thread was pinned to by pinToNode, or -1 if it never was
+static thread_local int boundNode = -1;
+
+/**
+* detect reads the machine's nodes and their CPUs from /sys/devices/system/node. A machine
+* without that (or without NUMA) is treated as one node with every CPU.
+*/
+
+NumaTopology NumaTopology::detect() {
+    NumaTopology topo;
+    for (int node = 0;; node++) {
+        ifstream in("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+        if (!in) {
+            break;
+        }
+        string list;
+        getline(in, list);
+        topo.nodeCpus.push_back(parseCpuList(list));
+    }
+    // No sysfs, one node with every CPU
+    if (topo.nodeCpus.empty()) {
+        vector<int> cpus(std::max(1u, thread::hardware_concurrency()));
+        for (size_t i = 0; i < cpus.size(); i++) {
+            cpus[i] = static_cast<int>(i);
+        }
+        topo.nodeCpus.push_back(cpus);
+    }
+    return topo;
+}
+
+/**
+* simulated makes up a topology of nodes nodes with cpusPerNode CPUs each, numbered in order.
+* Pinning to a simulated CPU pins to the real CPU with the same number modulo how many there are,
+* so everything still runs on a single node machine, and currentNode reports the simulated node.
+*/
+
+NumaTopology NumaTopology::simulated(size_t nodes, size_t cpusPerNode) {
+    NumaTopology topo;
+    topo.simulatedNodes = true;
+    int cpu = 0;
+    for (size_t n = 0; n < std::max<size_t>(nodes, 1); n++) {
+        vector<int> cpus;
+        for (size_t c = 0; c < std::max<size_t>(cpusPerNode, 1); c++) {
+            cpus.push_back(cpu++);
+        }
+        topo.nodeCpus.push_back(cpus);
+    }
+    return topo;
+}
+
+/**
+* nodeCount returns how many nodes there are.
+*/
+
+size_t NumaTopology::nodeCount() const {
+    return nodeCpus.size();
+}
+
+/**
+* nodeOfCpu returns the node a CPU belongs to, 0 if it isn't listed.
+*/
+
+int NumaTopology::nodeOfCpu(int cpu) const {
+    for (size_t n = 0; n < nodeCpus.size(); n++) {
+        if (find(nodeCpus[n].begin(), nodeCpus[n].end(), cpu) != nodeCpus[n].end()) {
+            return static_cast<int>(n);
+        }
+    }
+    return 0;
+}
+
+/**
+* parseCpuList turns a sysfs CPU list like "0-3,8-11" into the CPU numbers it names.
+*/
+
+vector<int> NumaTopology::parseCpuList(const std::string& list) {
+    vector<int> cpus;
+    stringstream in(list);
+    string part;
+    while (getline(in, part, ',')) {
+        if (part.empty()) {
+            continue;
+        }
+        size_t dash = part.find('-');
+        int first = stoi(part.substr(0, dash));
+        int last = (dash == string::npos) ? first : stoi(part.substr(dash + 1));
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+/**
+* The constructor starts one worker pinned to every node in the topology and has each worker make
+* its node's perNode shards, so their first buckets are first touched there.
+*/
+
+ShardedHashTable::ShardedHashTable(NumaTopology topo, size_t perNode, size_t capPerShard)
+    : topology(std::move(topo)), shardsPerNode(std::max<size_t>(perNode, 1)), localOps(0), remoteOps(0),
+      routedGrowths(0) {
+    shards.resize(topology.nodeCount() * shardsPerNode);
+    for (size_t node = 0; node < topology.nodeCount(); node++) {
+        workers.push_back(make_unique<NumaWorker>());
+    }
+    for (size_t node = 0; node < topology.nodeCount(); node++) {
+        workers[node]->runner = thread([this, node]() { workerLoop(node); });
+    }
+    vector<function<void()>> build(topology.nodeCount());
+    for (size_t node = 0; node < topology.nodeCount(); node++) {
+        build[node] = [this, node, capPerShard]() {
+            for (size_t s = node * shardsPerNode; s < (node + 1) * shardsPerNode; s++) {
+                shards[s] = make_unique<NumaShard>();
+                shards[s]->table = HashTable(capPerShard);
+                shards[s]->node = node;
+            }
+        };
+    }
+    runOnNodes(build);
+}
+
+/**
+* The destructor tells every worker to stop once its queue is empty and waits for them.
+*/
+
+ShardedHashTable::~ShardedHashTable() {
+    for (unique_ptr<NumaWorker>& worker : workers) {
+        {
+            lock_guard<mutex> guard(worker->lock);
+            worker->stopping = true;
+        }
+        worker->wake.notify_one();
+    }
+    for (unique_ptr<NumaWorker>& worker : workers) {
+        worker->runner.join();
+    }
+}
+
+/**
+* workerLoop is what each node's worker runs: it pins itself to the node once and then runs jobs
+* in the order they were queued until the table is destroyed.
+*/
+
+void ShardedHashTable::workerLoop(size_t node) {
+    pinToNode(node);
+    NumaWorker& worker = *workers[node];
+    vector<function<void()>> ready;
+    while (true) {
+        {
+            unique_lock<mutex> guard(worker.lock);
+            worker.wake.wait(guard, [&worker]() { return worker.stopping || !worker.jobs.empty(); });
+            if (worker.jobs.empty()) {
+                return;
+            }
+            ready.swap(worker.jobs);
+        }
+        for (function<void()>& job : ready) {
+            job();
+        }
+        ready.clear();
+    }
+}
+
+/**
+* runOnNodes hands perNode[n] to node n's worker, skipping empty entries, and waits for all of
+* them to finish. If any of them throws, the first exception is thrown again here. It must not be
+* called from a worker for another worker's node, so a worker never waits on another.
+*/
+
+void ShardedHashTable::runOnNodes(vector<function<void()>>& perNode) {
+    mutex doneLock;
+    condition_variable doneWake;
+    size_t remaining = 0;
+    exception_ptr failure;
+    for (size_t node = 0; node < perNode.size() && node < workers.size(); node++) {
+        if (!perNode[node]) {
+            continue;
+        }
+        remaining++;
+        NumaWorker& worker = *workers[node];
+        {
+            lock_guard<mutex> guard(worker.lock);
+            worker.jobs.push_back([&, node]() {
+                exception_ptr thrown;
+                try {
+                    perNode[node]();
+                } catch (...) {
+                    thrown = current_exception();
+                }
+                lock_guard<mutex> done(doneLock);
+                if (thrown && !failure) {
+                    failure = thrown;
+                }
+                // Notify while holding the lock, the waiter's locals go away once it sees 0
+                if (--remaining == 0) {
+                    doneWake.notify_one();
+                }
+            });
+        }
+        worker.wake.notify_one();
+    }
+    unique_lock<mutex> guard(doneLock);
+    doneWake.wait(guard, [&remaining]() { return remaining == 0; });
+    if (failure) {
+        rethrow_exception(failure);
+    }
+}
+
+/**
+* growLocally makes sure the shard's next insert won't resize it on the calling thread if that
+* thread is on another node. HashTable grows once it's half full, which reallocates every bucket,
+* so a shard about to grow is grown by its own node's worker instead, keeping its memory local.
+* Must be called without the shard's lock held.
+*/
+
+void ShardedHashTable::growLocally(size_t shard) {
+    NumaShard& target = *shards[shard];
+    if (target.node == currentNode()) {
+        return;
+    }
+    {
+        lock_guard<mutex> guard(target.lock);
+        if (target.table.alpha() < 0.5) {
+            return;
+        }
+    }
+    vector<function<void()>> grow(workers.size());
+    grow[target.node] = [this, &target]() {
+        lock_guard<mutex> guard(target.lock);
+        // Another insert may have grown it first
+        if (target.table.alpha() >= 0.5) {
+            target.table.resizeTable();
+            routedGrowths.fetch_add(1, memory_order_relaxed);
+        }
+    };
+    runOnNodes(grow);
+}
+
+/**
+* shardFor picks a key's shard from the high half of its hash, so it doesn't line up with the low
+* bits each shard uses to pick a bucket.
+*/
+
+size_t ShardedHashTable::shardFor(size_t hash) const {
+    return static_cast<size_t>(((static_cast<uint64_t>(hash) >> 32) * shards.size()) >> 32);
+}
+
+/**
+* nodeOfShard returns the node a shard's memory lives on.
+*/
+
+size_t ShardedHashTable::nodeOfShard(size_t shard) const {
+    return shard / shardsPerNode;
+}
+
+/**
+* localShards returns the shards that live on a node, for threads that want to scan or work on
+* only node-local memory.
+*/
+
+vector<size_t> ShardedHashTable::localShards(size_t node) const {
+    vector<size_t> local;
+    for (size_t s = node * shardsPerNode; s < (node + 1) * shardsPerNode && s < shards.size(); s++) {
+        local.push_back(s);
+    }
+    return local;
+}
+
+/**
+* currentNode returns the node the calling thread is running on. A thread pinned with pinToNode
+* reports that node, which is what makes a simulated topology work.
+*/
+
+size_t ShardedHashTable::currentNode() const {
+    if (boundNode >= 0) {
+        return static_cast<size_t>(boundNode);
+    }
+    int cpu = sched_getcpu();
+    return cpu < 0 ? 0 : static_cast<size_t>(topology.nodeOfCpu(cpu));
+}
+
+/**
+* pinToNode restricts the calling thread to the node's CPUs. With a simulated topology the CPU
+* numbers are wrapped onto the real ones. Returns false if the thread couldn't be pinned, in which
+* case it still reports the node from currentNode.
+*/
+
+bool ShardedHashTable::pinToNode(size_t node) const {
+    boundNode = static_cast<int>(node);
+    unsigned real = std::max(1u, thread::hardware_concurrency());
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : topology.nodeCpus[node % topology.nodeCount()]) {
+        int target = topology.simulatedNodes ? cpu % static_cast<int>(real) : cpu;
+        if (target < CPU_SETSIZE) {
+            CPU_SET(target, &set);
+        }
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+/**
+* countAccess records whether the calling thread is on the shard's node.
+*/
+
+void ShardedHashTable::countAccess(size_t shard) const {
+    atomic<size_t>& counter = (nodeOfShard(shard) == currentNode()) ? localOps : remoteOps;
+    counter.fetch_add(1, memory_order_relaxed);
+}
+
+/**
+* insert puts a new key-value pair in the key's shard. Duplicate keys are not allowed. Safe to
+* call from any thread, except a worker inserting into another node's shard. If the shard needs
+* to grow first, its node's worker grows it.
+*/
+
+bool ShardedHashTable::insert(const std::string& key, const size_t& value) {
+    size_t shard = shardFor(hasher(key));
+    countAccess(shard);
+    // Another thread can fill the shard back up between growing and locking, so check again
+    while (true) {
+        growLocally(shard);
+        lock_guard<mutex> guard(shards[shard]->lock);
+        if (shards[shard]->table.alpha() < 0.5 || shards[shard]->node == currentNode()) {
+            return shards[shard]->table.insert(key, value);
+        }
+    }
+}
+
+/**
+* remove takes the key out of its shard. Returns false if the key wasn't in the table.
+*/
+
+bool ShardedHashTable::remove(const std::string& key) {
+    size_t shard = shardFor(hasher(key));
+    countAccess(shard);
+    lock_guard<mutex> guard(shards[shard]->lock);
+    return shards[shard]->table.remove(key);
+}
+
+/**
+* contains returns true if the key is in the table.
+*/
+
+bool ShardedHashTable::contains(const string& key) const {
+    return get(key).has_value();
+}
+
+/**
+* get returns the key's value, or nullopt if it isn't in the table.
+*/
+
+optional<size_t> ShardedHashTable::get(const string& key) const {
+    size_t shard = shardFor(hasher(key));
+    countAccess(shard);
+    lock_guard<mutex> guard(shards[shard]->lock);
+    return shards[shard]->table.get(key);
+}
+
+/**
+* size returns how many key-value pairs are in every shard together.
+*/
+
+size_t ShardedHashTable::size() const {
+    size_t total = 0;
+    for (const unique_ptr<NumaShard>& shard : shards) {
+        lock_guard<mutex> guard(shard->lock);
+        total += shard->table.size();
+    }
+    return total;
+}
+
+/**
+* runBatch carries out a batch of requests from any thread except a worker. The requests are
+* sorted by the node of their key's shard and each node's share is run by that node's worker, so
+* every probe (and any resize, which allocates the new buckets) happens on node-local memory.
+* Results go back into each request's result and ok.
+*/
+
+void ShardedHashTable::runBatch(vector<ShardOp>& ops) {
+    // Split the requests by node
+    vector<vector<ShardOp*>> byNode(topology.nodeCount());
+    for (ShardOp& op : ops) {
+        byNode[nodeOfShard(shardFor(hasher(op.key)))].push_back(&op);
+    }
+    vector<function<void()>> perNode(byNode.size());
+    for (size_t node = 0; node < byNode.size(); node++) {
+        if (byNode[node].empty()) {
+            continue;
+        }
+        perNode[node] = [this, node, &byNode]() {
+            for (ShardOp* op : byNode[node]) {
+                switch (op->type) {
+                    case ShardOpType::INSERT:
+                        op->ok = insert(op->key, op->value);
+                        break;
+                    case ShardOpType::REMOVE:
+                        op->ok = remove(op->key);
+                        break;
+                    case ShardOpType::GET:
+                        op->result = get(op->key);
+                        op->ok = op->result.has_value();
+                        break;
+                }
+            }
+        };
+    }
+    runOnNodes(perNode);
+}
@@ -0,0 +1,111 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the header file for the NumaTopology and ShardedHashTable classes. A ShardedHashTable
+* splits its keys over several HashTable shards and gives each NUMA node its own set of shards.
+* Every node gets one worker thread, pinned there for the table's whole life. Each shard is built by
+* its node's worker, so its buckets are first touched (and so placed) in that node's memory, any
+* growth that would reallocate a shard from another node's thread is handed to that worker too, and
+* batches of requests are sent to the workers instead of being run from wherever the caller happens
+* to be. NumaTopology reads the real layout from sysfs, or can make up a simulated one for testing
+* on a single node machine. This file includes: The NumaTopology detect function, the simulated
+* function, the nodeCount function, the nodeOfCpu function, the parseCpuList function, the
+* ShardedHashTable constructor and destructor, the insert function, the remove function, the
+* contains function, the get function, the size function, the runBatch function, the shardFor
+* function, the nodeOfShard function, the localShards function, the currentNode function, the
+* pinToNode function, the countAccess function, the runOnNodes function, the workerLoop function,
+* the growLocally function, the NumaShard, NumaWorker and ShardOp classes.
+* -----------------------------------------------------------------------------------------*/
+#pragma once
+
+#include "HashTable.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Which CPUs belong to which node
+class NumaTopology {
+    public:
+        // NumaTopology variables
+        vector <vector<int>> nodeCpus;
+        bool simulatedNodes = false;
+        // NumaTopology function declarations
+        static NumaTopology detect();
+        static NumaTopology simulated(size_t nodes, size_t cpusPerNode);
+        size_t nodeCount() const;
+        int nodeOfCpu(int cpu) const;
+        static vector<int> parseCpuList(const std::string& list);
+};
+
+// One shard, on its own cache lines so shards' locks don't share a line
+struct alignas(64) NumaShard {
+    HashTable table;
+    mutable mutex lock;
+    size_t node = 0;
+};
+
+// One node's worker thread and the jobs waiting for it
+struct NumaWorker {
+    thread runner;
+    mutex lock;
+    condition_variable wake;
+    vector <function<void()>> jobs;
+    bool stopping = false;
+};
+
+// enum types for batched requests
+enum class ShardOpType {INSERT, REMOVE, GET};
+
+// One batched request, result and ok are filled in by runBatch
+struct ShardOp {
+    ShardOpType type;
+    std::string key;
+    size_t value = 0;
+    optional<size_t> result;
+    bool ok = false;
+};
+
+class ShardedHashTable {
+    public:
+        // ShardedHashTable variables
+        NumaTopology topology;
+        vector <unique_ptr<NumaShard>> shards;
+        vector <unique_ptr<NumaWorker>> workers;
+        size_t shardsPerNode;
+        mutable atomic<size_t> localOps;
+        mutable atomic<size_t> remoteOps;
+        atomic<size_t> routedGrowths;
+        // ShardedHashTable constructor and destructor declarations
+        explicit ShardedHashTable(NumaTopology topo = NumaTopology::detect(), size_t perNode = 4, size_t capPerShard = 8);
+        ~ShardedHashTable();
+        ShardedHashTable(const ShardedHashTable&) = delete;
+        ShardedHashTable& operator=(const ShardedHashTable&) = delete;
+        // ShardedHashTable function declarations
+        bool insert(const std::string& key, const size_t& value);
+        bool remove(const std::string& key);
+        bool contains(const string& key) const;
+        optional<size_t> get(const string& key) const;
+        size_t size() const;
+        void runBatch(vector<ShardOp>& ops);
+        size_t shardFor(size_t hash) const;
+        size_t nodeOfShard(size_t shard) const;
+        vector<size_t> localShards(size_t node) const;
+        size_t currentNode() const;
+        bool pinToNode(size_t node) const;
+        void countAccess(size_t shard) const;
+        void runOnNodes(vector<function<void()>>& perNode);
+        void workerLoop(size_t node);
+        void growLocally(size_t shard);
+        // Hasher declaration
+        std::hash<std::string> hasher;
+};
@@ -0,0 +1,197 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the header file for the StaticHashTable class template. A StaticHashTable is built
+* entirely at compile time from a fixed list of keys: the keys are hashed with FNV-1a, laid out in
+* a power of two array of slots, and the whole table lives in static storage with no heap and no
+* startup work. The layout search tries hash seeds until every key sits within MaxProbe slots of
+* its home, and a key set that can't be laid out that way fails to compile. This file includes:
+* The StaticHashTable constructor, the get function, the contains function, the capacity function,
+* the size function, the maxProbe function, the slotFor function, the staticHash function, the
+* makeStaticHashTable function.
+* -----------------------------------------------------------------------------------------*/
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+using namespace std;
+
+// How many hash seeds the layout search tries before giving up
+constexpr uint64_t STATIC_SEED_TRIES = 256;
+
+/**
+* staticHash is 64-bit FNV-1a over the key's bytes, started from a seeded offset basis so the
+* layout search can try a new set of home slots. It's constexpr so the same function hashes keys
+* at compile time and at run time.
+*/
+
+constexpr uint64_t staticHash(string_view key, uint64_t seed) {
+    // FNV-1a offset basis, moved by the seed
+    uint64_t hash = 0xCBF29CE484222325ULL ^ (seed * 0x9E3779B97F4A7C15ULL);
+    for (char c : key) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001B3ULL;
+    }
+    // Fold the high bits down since the slot comes from the low bits
+    return hash ^ (hash >> 32);
+}
+
+// One slot of a StaticHashTable, the key points at the string literal it came from
+struct StaticSlot {
+    string_view key;
+    size_t value = 0;
+    bool used = false;
+};
+
+template <size_t N, size_t MaxProbe = 2>
+class StaticHashTable {
+    public:
+        static_assert(N > 0, "a StaticHashTable needs at least one key");
+        static_assert(MaxProbe > 0, "every key needs at least its home slot");
+        // Twice as many slots as keys, rounded up to a power of two so a mask finds the slot
+        static constexpr size_t CAP = bit_ceil(N * 2);
+        // StaticHashTable variables
+        array<StaticSlot, CAP> slots{};
+        uint64_t seed = 0;
+        size_t longest = 0;
+        // StaticHashTable constructor declaration
+        consteval explicit StaticHashTable(const pair<string_view, size_t> (&entries)[N]);
+        // StaticHashTable function declarations
+        constexpr optional<size_t> get(string_view key) const;
+        constexpr bool contains(string_view key) const;
+        constexpr size_t capacity() const;
+        constexpr size_t size() const;
+        constexpr size_t maxProbe() const;
+        constexpr size_t slotFor(string_view key) const;
+};
+
+/**
+* The constructor lays the keys out at compile time. For each seed it puts every key in the first
+* free slot at or after its home, and keeps the first seed where no key is more than MaxProbe
+* slots in. It's consteval, so a duplicate key or a key set that needs a longer probe stops the
+* build at the throw instead of failing at run time.
+*/
+
+template <size_t N, size_t MaxProbe>
+consteval StaticHashTable<N, MaxProbe>::StaticHashTable(const pair<string_view, size_t> (&entries)[N]) {
+    // Duplicate keys can never be told apart
+    for (size_t i = 0; i < N; i++) {
+        for (size_t j = i + 1; j < N; j++) {
+            if (entries[i].first == entries[j].first) {
+                throw exception();
+            }
+        }
+    }
+    for (uint64_t trySeed = 0; trySeed < STATIC_SEED_TRIES; trySeed++) {
+        slots = {};
+        seed = trySeed;
+        longest = 0;
+        bool fits = true;
+        for (size_t e = 0; e < N && fits; e++) {
+            size_t home = staticHash(entries[e].first, seed) & (CAP - 1);
+            // Walk forward to the first free slot
+            size_t step = 0;
+            while (slots[(home + step) & (CAP - 1)].used) {
+                step++;
+            }
+            // Too far from home, try the next seed
+            if (step >= MaxProbe) {
+                fits = false;
+                break;
+            }
+            slots[(home + step) & (CAP - 1)] = StaticSlot{entries[e].first, entries[e].second, true};
+            longest = std::max(longest, step + 1);
+        }
+        if (fits) {
+            return;
+        }
+    }
+    // No seed kept every key within MaxProbe slots, so raise MaxProbe
+    throw exception();
+}
+
+/**
+* slotFor returns the key's home slot under the seed the layout was built with.
+*/
+
+template <size_t N, size_t MaxProbe>
+constexpr size_t StaticHashTable<N, MaxProbe>::slotFor(string_view key) const {
+    return staticHash(key, seed) & (CAP - 1);
+}
+
+/**
+* get returns the value for the key, or nullopt if it isn't one of the built in keys. At most
+* maxProbe slots are ever checked, and with the default MaxProbe of 2 most keys are found in one.
+*/
+
+template <size_t N, size_t MaxProbe>
+constexpr optional<size_t> StaticHashTable<N, MaxProbe>::get(string_view key) const {
+    size_t home = slotFor(key);
+    for (size_t step = 0; step < longest; step++) {
+        const StaticSlot& slot = slots[(home + step) & (CAP - 1)];
+        // An empty slot means the key was never placed
+        if (!slot.used) {
+            return nullopt;
+        }
+        if (slot.key == key) {
+            return slot.value;
+        }
+    }
+    // The key was not in the table, return nullopt
+    return nullopt;
+}
+
+/**
+* contains returns true if the key is one of the built in keys.
+*/
+
+template <size_t N, size_t MaxProbe>
+constexpr bool StaticHashTable<N, MaxProbe>::contains(string_view key) const {
+    return get(key).has_value();
+}
+
+/**
+* capacity returns how many slots the table has.
+*/
+
+template <size_t N, size_t MaxProbe>
+constexpr size_t StaticHashTable<N, MaxProbe>::capacity() const {
+    return CAP;
+}
+
+/**
+* size returns how many keys the table was built with.
+*/
+
+template <size_t N, size_t MaxProbe>
+constexpr size_t StaticHashTable<N, MaxProbe>::size() const {
+    return N;
+}
+
+/**
+* maxProbe returns the most slots any key needs to be found, which is never more than MaxProbe.
+* It can be checked with a static_assert to pin down the worst case lookup.
+*/
+
+template <size_t N, size_t MaxProbe>
+constexpr size_t StaticHashTable<N, MaxProbe>::maxProbe() const {
+    return longest;
+}
+
+/**
+* makeStaticHashTable builds a table from a braced list of pairs and works out N from the list:
+* constexpr auto commands = makeStaticHashTable({{"get", 1}, {"set", 2}});
+*/
+
+template <size_t MaxProbe = 2, size_t N>
+consteval StaticHashTable<N, MaxProbe> makeStaticHashTable(const pair<string_view, size_t> (&entries)[N]) {
+    return StaticHashTable<N, MaxProbe>(entries);
+}
@@ -0,0 +1,380 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the cpp file for the TieredHashTable class. It contains the constructor and all the
+* function definitions. A segment in the spill file is stored as its pairs back to back (key
+* length, value, key bytes), and is rehashed into a right sized HashTable when it's paged back in.
+* This file includes: The TieredHashTable constructor and destructor, the open function, the close
+* function, the insert function, the remove function, the contains function, the get function,
+* the getBatch function, the size function, the residentSegments function, the segmentFor
+* function, the residentTable function, the pageIn function, the evict function, the evictColdest
+* function, the allocate function, the release function.
+* -----------------------------------------------------------------------------------------*/
+
+#include "TieredHashTable.h"
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+/**
+* The default constructor leaves the table closed. open has to be called before anything else.
+*/
+
+TieredHashTable::TieredHashTable() {
+    spillFd = -1;
+    fileEnd = 0;
+    maxResident = 0;
+    resident = 0;
+    filled = 0;
+    useClock = 0;
+    pageIns = 0;
+    evictions = 0;
+}
+
+/**
+* The destructor closes and deletes the spill file.
+*/
+
+TieredHashTable::~TieredHashTable() {
+    close();
+}
+
+/**
+* open creates an empty table with segmentCount segments that spills to the file at path, keeping
+* at most residentLimit segments in memory. The spill file is scratch space, it's emptied here
+* and deleted by close. Returns false if the file can't be created.
+*/
+
+bool TieredHashTable::open(const std::string& path, size_t segmentCount, size_t residentLimit) {
+    close();
+    spillFd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (spillFd < 0) {
+        return false;
+    }
+    spillPath = path;
+    // Every segment starts out empty and on disk, so nothing is in memory yet
+    segments = vector<TieredSegment>(std::max<size_t>(segmentCount, 1));
+    maxResident = std::max<size_t>(residentLimit, 1);
+    fileEnd = 0;
+    freeSpace.clear();
+    resident = 0;
+    filled = 0;
+    return true;
+}
+
+/**
+* close frees every segment and deletes the spill file. Calling it on a closed table does nothing.
+*/
+
+void TieredHashTable::close() {
+    if (spillFd < 0) {
+        return;
+    }
+    ::close(spillFd);
+    unlink(spillPath.c_str());
+    spillFd = -1;
+    segments.clear();
+    freeSpace.clear();
+    resident = 0;
+    filled = 0;
+}
+
+/**
+* segmentFor picks the key's segment from the high half of its hash, so it doesn't line up with
+* the low bits each segment's HashTable uses to pick a bucket.
+*/
+
+size_t TieredHashTable::segmentFor(size_t hash) const {
+    return static_cast<size_t>(((static_cast<uint64_t>(hash) >> 32) * segments.size()) >> 32);
+}
+
+/**
+* residentTable returns the segment's table, paging it in first if it's on disk. For a read it
+* returns nullptr without touching the disk when the segment is empty or its filter rules the key
+* out. Paging a segment in can push the coldest other segment out to disk. It doesn't mark the
+* segment dirty, the caller does that once it has actually changed something.
+*/
+
+HashTable* TieredHashTable::residentTable(size_t seg, size_t hash, bool forWrite) {
+    // Throws an exception if the table was never opened
+    if (spillFd < 0) {
+        throw exception();
+    }
+    TieredSegment& segment = segments[seg];
+    if (!segment.table) {
+        // Misses on a segment that's on disk are answered from memory
+        if (!forWrite && (segment.count == 0 || !segment.filter.mayContain(hash))) {
+            return nullptr;
+        }
+        pageIn(seg);
+    }
+    segment.lastUse = ++useClock;
+    // Make room for the segment that was just paged in
+    if (resident > maxResident) {
+        evictColdest(seg);
+    }
+    return segment.table.get();
+}
+
+/**
+* pageIn reads a segment back from the spill file into a HashTable sized so it won't resize
+* while it's being filled.
+*/
+
+void TieredHashTable::pageIn(size_t seg) {
+    TieredSegment& segment = segments[seg];
+    segment.table = make_unique<HashTable>(segment.count * 2 + 8);
+    resident++;
+    segment.dirty = false;
+    if (segment.fileLength > 0) {
+        string data(segment.fileLength, '\0');
+        if (pread(spillFd, data.data(), data.size(), segment.fileOffset) != static_cast<ssize_t>(data.size())) {
+            throw exception();
+        }
+        // Pairs are key length, value, key bytes
+        size_t pos = 0;
+        while (pos < data.size()) {
+            uint32_t keyLength;
+            uint64_t value;
+            memcpy(&keyLength, data.data() + pos, sizeof(keyLength));
+            memcpy(&value, data.data() + pos + sizeof(keyLength), sizeof(value));
+            pos += sizeof(keyLength) + sizeof(value);
+            segment.table->insert(data.substr(pos, keyLength), value);
+            pos += keyLength;
+        }
+    }
+    // The filter is only needed while the segment is on disk
+    segment.filter.clear();
+    pageIns++;
+}
+
+/**
+* evict writes a segment to the spill file if it changed since it was paged in, builds its filter
+* and frees its table. A segment that's no bigger than the space it had is written back in place,
+* otherwise its old space is given back and it's written wherever allocate finds room.
+*/
+
+void TieredHashTable::evict(size_t seg) {
+    TieredSegment& segment = segments[seg];
+    segment.count = segment.table->size();
+    segment.filter.reset(segment.count, TIERED_FILTER_BITS);
+    string data;
+    const HashTable& table = *segment.table;
+    for (auto it = table.begin(); it != table.end(); ++it) {
+        segment.filter.add(hasher(it.key()));
+        if (segment.dirty) {
+            auto keyLength = static_cast<uint32_t>(it.key().size());
+            uint64_t value = it.value();
+            data.append(reinterpret_cast<const char*>(&keyLength), sizeof(keyLength));
+            data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+            data.append(it.key());
+        }
+    }
+    if (segment.dirty) {
+        // Reuse the segment's old space if it still fits
+        if (data.size() > segment.fileSpace) {
+            release(segment.fileOffset, segment.fileSpace);
+            segment.fileOffset = allocate(data.size());
+            segment.fileSpace = data.size();
+        }
+        if (pwrite(spillFd, data.data(), data.size(), segment.fileOffset) != static_cast<ssize_t>(data.size())) {
+            throw exception();
+        }
+        segment.fileLength = data.size();
+        segment.dirty = false;
+    }
+    segment.table.reset();
+    resident--;
+    evictions++;
+}
+
+/**
+* evictColdest evicts the least recently used segment other than keep.
+*/
+
+void TieredHashTable::evictColdest(size_t keep) {
+    size_t coldest = segments.size();
+    for (size_t s = 0; s < segments.size(); s++) {
+        if (s != keep && segments[s].table
+            && (coldest == segments.size() || segments[s].lastUse < segments[coldest].lastUse)) {
+            coldest = s;
+        }
+    }
+    if (coldest != segments.size()) {
+        evict(coldest);
+    }
+}
+
+/**
+* allocate returns where in the spill file length bytes can be written. It takes the first free
+* extent that's big enough, keeping whatever is left of it free, and only grows the file when no
+* extent fits.
+*/
+
+uint64_t TieredHashTable::allocate(uint64_t length) {
+    for (auto it = freeSpace.begin(); it != freeSpace.end(); ++it) {
+        if (it->second < length) {
+            continue;
+        }
+        uint64_t offset = it->first;
+        // Shrink the extent from the front, or drop it if it's used up
+        if (it->second == length) {
+            freeSpace.erase(it);
+        } else {
+            it->first += length;
+            it->second -= length;
+        }
+        return offset;
+    }
+    // Nothing fits, put it at the end of the file
+    uint64_t offset = fileEnd;
+    fileEnd += length;
+    return offset;
+}
+
+/**
+* release gives an extent of the spill file back so allocate can hand it out again. The free list
+* is kept sorted by offset and neighbouring extents are merged, so space freed by segments next
+* to each other can hold one bigger segment. Free space at the end of the file is cut off instead.
+*/
+
+void TieredHashTable::release(uint64_t offset, uint64_t length) {
+    if (length == 0) {
+        return;
+    }
+    auto it = lower_bound(freeSpace.begin(), freeSpace.end(), make_pair(offset, uint64_t{0}));
+    // Merge with the extent right after it
+    if (it != freeSpace.end() && offset + length == it->first) {
+        length += it->second;
+        it = freeSpace.erase(it);
+    }
+    // Merge with the extent right before it
+    if (it != freeSpace.begin() && prev(it)->first + prev(it)->second == offset) {
+        --it;
+        offset = it->first;
+        length += it->second;
+        it = freeSpace.erase(it);
+    }
+    if (offset + length == fileEnd) {
+        // The end of the file is free, so the file just gets shorter
+        fileEnd = offset;
+        if (ftruncate(spillFd, static_cast<off_t>(fileEnd)) != 0) {
+            throw exception();
+        }
+    } else {
+        freeSpace.insert(it, make_pair(offset, length));
+    }
+}
+
+/**
+* insert puts a new key-value pair in the key's segment. Duplicate keys are not allowed, and
+* trying to insert one leaves the segment clean so it isn't written out again for nothing.
+*/
+
+bool TieredHashTable::insert(const std::string& key, const size_t& value) {
+    size_t hash = hasher(key);
+    bool inserted = residentTable(segmentFor(hash), hash, true)->insert(key, value);
+    if (inserted) {
+        segments[segmentFor(hash)].dirty = true;
+    }
+    filled += inserted;
+    return inserted;
+}
+
+/**
+* remove takes the key out of its segment. Returns false if the key wasn't in the table.
+*/
+
+bool TieredHashTable::remove(const std::string& key) {
+    size_t hash = hasher(key);
+    HashTable* table = residentTable(segmentFor(hash), hash, false);
+    if (table == nullptr || !table->remove(key)) {
+        return false;
+    }
+    // Only now has the segment actually changed
+    segments[segmentFor(hash)].dirty = true;
+    filled--;
+    return true;
+}
+
+/**
+* contains returns true if the key is in the table.
+*/
+
+bool TieredHashTable::contains(const string& key) {
+    return get(key).has_value();
+}
+
+/**
+* get returns the key's value, or nullopt if it isn't in the table. The key's segment is paged in
+* if it's on disk and its filter says the key might be there.
+*/
+
+optional<size_t> TieredHashTable::get(const string& key) {
+    size_t hash = hasher(key);
+    HashTable* table = residentTable(segmentFor(hash), hash, false);
+    // The key was not in the table, return nullopt
+    if (table == nullptr) {
+        return nullopt;
+    }
+    return table->get(key);
+}
+
+/**
+* getBatch looks up many keys at once. The keys are grouped by segment, the kernel is told up
+* front to start reading every on-disk segment the batch needs (read-ahead), and then each
+* segment is paged in once and all of its keys looked up together. Results are in the same order
+* as keys.
+*/
+
+vector<optional<size_t>> TieredHashTable::getBatch(const vector<std::string>& keys) {
+    vector<optional<size_t>> results(keys.size());
+    // Hash every key once and sort them by segment
+    vector<pair<size_t, size_t>> order;
+    vector<size_t> hashes(keys.size());
+    order.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        hashes[i] = hasher(keys[i]);
+        order.emplace_back(segmentFor(hashes[i]), i);
+    }
+    sort(order.begin(), order.end());
+    // Start reading every segment that will have to come in from disk
+    for (size_t i = 0; i < order.size(); i++) {
+        const TieredSegment& segment = segments[order[i].first];
+        bool firstOfSegment = i == 0 || order[i - 1].first != order[i].first;
+        if (firstOfSegment && !segment.table && segment.fileLength > 0) {
+            posix_fadvise(spillFd, segment.fileOffset, segment.fileLength, POSIX_FADV_WILLNEED);
+        }
+    }
+    // Each segment is paged in at most once for the whole batch
+    for (const auto& [seg, i] : order) {
+        HashTable* table = residentTable(seg, hashes[i], false);
+        if (table != nullptr) {
+            results[i] = table->get(keys[i]);
+        }
+    }
+    return results;
+}
+
+/**
+* size returns how many key-value pairs are in the table, on disk or not.
+*/
+
+size_t TieredHashTable::size() const {
+    return filled;
+}
+
+/**
+* residentSegments returns how many segments are in memory right now.
+*/
+
+size_t TieredHashTable::residentSegments() const {
+    return resident;
+}
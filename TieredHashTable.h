@@ -0,0 +1,83 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the header file for the TieredHashTable class. The hash space is split into a fixed
+* number of segments, each its own HashTable, and only maxResident of them are kept in memory at
+* once. A segment that goes cold is written to a spill file and freed, leaving behind only its
+* file position, its key count and a small Bloom filter so misses don't have to read it back in.
+* Space in the file that a segment grows out of goes on a free list for the next segment that needs
+* room. Segments grow on their own, so a resize only ever doubles one segment rather than the whole
+* table. This file includes: The TieredHashTable constructor and destructor, the open function, the
+* close function, the insert function, the remove function, the contains function, the get function,
+* the getBatch function, the size function, the residentSegments function, the segmentFor function,
+* the residentTable function, the pageIn function, the evict function, the evictColdest function,
+* the allocate function, the release function, the TieredSegment class.
+* -----------------------------------------------------------------------------------------*/
+#pragma once
+
+#include "BloomFilter.h"
+#include "HashTable.h"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Filter bits per key kept in memory for a segment that's on disk
+constexpr size_t TIERED_FILTER_BITS = 10;
+
+// One slice of the hash space. table is null while the segment is in the spill file.
+struct TieredSegment {
+    unique_ptr<HashTable> table;
+    BloomFilter filter;
+    uint64_t fileOffset = 0;
+    uint64_t fileLength = 0;
+    uint64_t fileSpace = 0;
+    size_t count = 0;
+    uint64_t lastUse = 0;
+    bool dirty = false;
+};
+
+class TieredHashTable {
+    public:
+        // TieredHashTable variables
+        vector <TieredSegment> segments;
+        std::string spillPath;
+        int spillFd;
+        uint64_t fileEnd;
+        vector <pair<uint64_t, uint64_t>> freeSpace;
+        size_t maxResident;
+        size_t resident;
+        size_t filled;
+        uint64_t useClock;
+        size_t pageIns;
+        size_t evictions;
+        // TieredHashTable constructor and destructor declarations
+        TieredHashTable();
+        ~TieredHashTable();
+        TieredHashTable(const TieredHashTable&) = delete;
+        TieredHashTable& operator=(const TieredHashTable&) = delete;
+        // TieredHashTable function declarations
+        bool open(const std::string& path, size_t segmentCount = 64, size_t residentLimit = 8);
+        void close();
+        bool insert(const std::string& key, const size_t& value);
+        bool remove(const std::string& key);
+        bool contains(const string& key);
+        optional<size_t> get(const string& key);
+        vector<optional<size_t>> getBatch(const vector<std::string>& keys);
+        size_t size() const;
+        size_t residentSegments() const;
+        size_t segmentFor(size_t hash) const;
+        HashTable* residentTable(size_t seg, size_t hash, bool forWrite);
+        void pageIn(size_t seg);
+        void evict(size_t seg);
+        void evictColdest(size_t keep);
+        uint64_t allocate(uint64_t length);
+        void release(uint64_t offset, uint64_t length);
+        // Hasher declaration
+        std::hash<std::string> hasher;
+};
@@ -0,0 +1,285 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the cpp file for the VersionedHashTable class. It contains the constructor and all the
+* function definitions. Pages and the page list are only ever changed when this version is the
+* only one using them, otherwise they're copied first, so a snapshot never sees a later write.
+* This file includes: The VersionedHashTable constructor, the insert function, the
+* insert_or_assign function, the remove function, the contains function, the get function, the
+* keys function, the alpha function, the capacity function, the size function, the snapshot
+* function, the toHashTable function, the sharedPages function, the locate function, the bucket
+* function, the writableBucket function, the probe function, the resizeTable function.
+* -----------------------------------------------------------------------------------------*/
+
+#include "VersionedHashTable.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+* The constructor takes an initial capacity, 8 if none is given, and splits the buckets into pages
+* of VERSION_PAGE_BUCKETS. Only the last page can be smaller.
+*/
+
+VersionedHashTable::VersionedHashTable(size_t cap) {
+    max = std::max<size_t>(cap, 1);
+    filled = 0;
+    copiedPages = 0;
+    offsets = make_shared<const vector<size_t>>(HashTable::offsetShuffle(max));
+    pages = make_shared<VersionDirectory>();
+    for (size_t first = 0; first < max; first += VERSION_PAGE_BUCKETS) {
+        pages->push_back(make_shared<VersionPage>(std::min(VERSION_PAGE_BUCKETS, max - first)));
+    }
+}
+
+/**
+* bucket returns bucket i for reading. Reads never copy anything.
+*/
+
+const HashTableBucket& VersionedHashTable::bucket(size_t i) const {
+    return (*(*pages)[i / VERSION_PAGE_BUCKETS])[i % VERSION_PAGE_BUCKETS];
+}
+
+/**
+* writableBucket returns bucket i for writing. If another version is still using the page list or
+* the page, that one is copied first and this version switches to the copy. Only the writer calls
+* this, and use_count can only drop to 1 once every other version has let go, so nobody can be
+* reading a page while it's being changed.
+*/
+
+HashTableBucket& VersionedHashTable::writableBucket(size_t i) {
+    // The page list is shared with a snapshot, copy the list of pointers (not the pages)
+    if (pages.use_count() > 1) {
+        pages = make_shared<VersionDirectory>(*pages);
+    }
+    shared_ptr<VersionPage>& page = (*pages)[i / VERSION_PAGE_BUCKETS];
+    // The page itself is shared, copy just this page
+    if (page.use_count() > 1) {
+        page = make_shared<VersionPage>(*page);
+        copiedPages++;
+    }
+    // Make sure the other versions are done with it before writing
+    atomic_thread_fence(memory_order_acquire);
+    return (*page)[i % VERSION_PAGE_BUCKETS];
+}
+
+/**
+* probe returns the bucket for step i of the probe sequence starting at home.
+*/
+
+size_t VersionedHashTable::probe(size_t home, size_t i) const {
+    return (home + (*offsets)[i]) % max;
+}
+
+/**
+* locate returns the bucket holding the key, or max if it isn't in this version. If firstEmpty is
+* given it's set to the first ESS or EAR bucket seen on the way.
+*/
+
+size_t VersionedHashTable::locate(const std::string& key, size_t* firstEmpty) const {
+    if (firstEmpty != nullptr) {
+        *firstEmpty = max;
+    }
+    size_t home = hasher(key) % max;
+    for (size_t i = 0; i < max; i++) {
+        size_t hole = (i == 0) ? home : probe(home, i - 1);
+        const HashTableBucket& current = bucket(hole);
+        if (current.type == bucketType::NORMAL) {
+            if (current.bucketKey == key) {
+                return hole;
+            }
+            continue;
+        }
+        // Remember the first open bucket for insert
+        if (firstEmpty != nullptr && *firstEmpty == max) {
+            *firstEmpty = hole;
+        }
+        // If ESS, stop trying
+        if (current.type == bucketType::ESS) {
+            return max;
+        }
+    }
+    // The key was not in the table
+    return max;
+}
+
+/**
+* insert puts a new key-value pair in this version. Duplicate keys are not allowed, so it
+* returns false if the key is already there. Snapshots taken before the insert don't see it.
+*/
+
+bool VersionedHashTable::insert(const std::string& key, const size_t& value) {
+    size_t open;
+    if (locate(key, &open) != max) {
+        return false;
+    }
+    // If the table is half full it gets expanded
+    if (alpha() >= 0.5) {
+        resizeTable();
+        locate(key, &open);
+    }
+    writableBucket(open).load(key, value);
+    filled++;
+    return true;
+}
+
+/**
+* insert_or_assign sets the key's value whether it's new or not. Returns true if the key was new.
+*/
+
+bool VersionedHashTable::insert_or_assign(const std::string& key, const size_t& value) {
+    size_t hole = locate(key);
+    if (hole != max) {
+        writableBucket(hole).bucketValue = value;
+        return false;
+    }
+    return insert(key, value);
+}
+
+/**
+* remove takes the key out of this version, leaving an EAR bucket. Returns false if the key
+* wasn't there.
+*/
+
+bool VersionedHashTable::remove(const std::string& key) {
+    size_t hole = locate(key);
+    // The key was not in the table
+    if (hole == max) {
+        return false;
+    }
+    HashTableBucket& current = writableBucket(hole);
+    current.load("", 0);
+    current.type = bucketType::EAR;
+    filled--;
+    return true;
+}
+
+/**
+* contains returns true if the key is in this version.
+*/
+
+bool VersionedHashTable::contains(const string& key) const {
+    return locate(key) != max;
+}
+
+/**
+* get returns the key's value, or nullopt if it isn't in this version.
+*/
+
+optional<size_t> VersionedHashTable::get(const string& key) const {
+    size_t hole = locate(key);
+    // The key was not in the table, return nullopt
+    if (hole == max) {
+        return nullopt;
+    }
+    return bucket(hole).bucketValue;
+}
+
+/**
+* keys returns a copy of every key in this version.
+*/
+
+vector<std::string> VersionedHashTable::keys() const {
+    vector<string> keys;
+    keys.reserve(filled);
+    for (const shared_ptr<VersionPage>& page : *pages) {
+        for (const HashTableBucket& current : *page) {
+            if (!current.isEmpty()) {
+                keys.push_back(current.bucketKey);
+            }
+        }
+    }
+    return keys;
+}
+
+/**
+* alpha returns the load factor, size/capacity.
+*/
+
+double VersionedHashTable::alpha() const {
+    return static_cast<double>(filled) / static_cast<double>(max);
+}
+
+/**
+* capacity returns how many buckets are in the table.
+*/
+
+size_t VersionedHashTable::capacity() const {
+    return max;
+}
+
+/**
+* size returns how many key-value pairs are in this version.
+*/
+
+size_t VersionedHashTable::size() const {
+    return filled;
+}
+
+/**
+* snapshot returns a read-consistent version of the table as it is right now. Only the page list
+* pointer and the offsets pointer are copied, so this is O(1). The snapshot can be read from
+* other threads while this table keeps changing, and it can be written to as well without
+* affecting this table. Call it from the writer's thread.
+*/
+
+VersionedHashTable VersionedHashTable::snapshot() const {
+    return *this;
+}
+
+/**
+* toHashTable copies this version into a plain HashTable, for exporting a point-in-time view.
+*/
+
+HashTable VersionedHashTable::toHashTable() const {
+    HashTable result(max);
+    for (const shared_ptr<VersionPage>& page : *pages) {
+        for (const HashTableBucket& current : *page) {
+            if (!current.isEmpty()) {
+                result.insert(current.bucketKey, current.bucketValue);
+            }
+        }
+    }
+    return result;
+}
+
+/**
+* sharedPages returns how many of this version's pages are also used by another version.
+*/
+
+size_t VersionedHashTable::sharedPages() const {
+    size_t shared = 0;
+    for (const shared_ptr<VersionPage>& page : *pages) {
+        // The page list itself might be shared, which shares every page in it
+        if (pages.use_count() > 1 || page.use_count() > 1) {
+            shared++;
+        }
+    }
+    return shared;
+}
+
+/**
+* resizeTable doubles the capacity into a brand new set of pages and offsets. Snapshots keep the
+* old pages, so nothing they hold is touched.
+*/
+
+void VersionedHashTable::resizeTable() {
+    VersionedHashTable bigger(max * 2);
+    for (const shared_ptr<VersionPage>& page : *pages) {
+        for (const HashTableBucket& current : *page) {
+            if (!current.isEmpty()) {
+                size_t open;
+                bigger.locate(current.bucketKey, &open);
+                bigger.writableBucket(open).load(current.bucketKey, current.bucketValue);
+            }
+        }
+    }
+    pages = std::move(bigger.pages);
+    offsets = std::move(bigger.offsets);
+    max = bigger.max;
+}
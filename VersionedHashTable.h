@@ -0,0 +1,63 @@
+/*-------------------------------------------------------------------------------------------
+* Name: Garry Francis
+* Project: HashTable
+*
+* This is the header file for the VersionedHashTable class. It probes the same way HashTable does,
+* but its buckets are split into fixed size pages that are shared between versions of the table.
+* snapshot() hands out a new version that shares every page, so it costs O(1) no matter how big
+* the table is, and a write only copies the one page it lands in (plus the page list, the first
+* time after a snapshot). Readers can keep using a snapshot while the writer carries on. This file
+* includes: The VersionedHashTable constructor, the insert function, the insert_or_assign
+* function, the remove function, the contains function, the get function, the keys function, the
+* alpha function, the capacity function, the size function, the snapshot function, the
+* toHashTable function, the sharedPages function, the locate function, the bucket function, the
+* writableBucket function, the probe function, the resizeTable function.
+* -----------------------------------------------------------------------------------------*/
+#pragma once
+
+#include "HashTable.h"
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Buckets in one copy-on-write page
+constexpr size_t VERSION_PAGE_BUCKETS = 64;
+
+// A page of buckets, and the list of pages that makes up one version
+using VersionPage = vector<HashTableBucket>;
+using VersionDirectory = vector<shared_ptr<VersionPage>>;
+
+class VersionedHashTable {
+    public:
+        // VersionedHashTable variables
+        shared_ptr<VersionDirectory> pages;
+        shared_ptr<const vector<size_t>> offsets;
+        size_t filled;
+        size_t max;
+        size_t copiedPages;
+        // VersionedHashTable constructor declaration
+        explicit VersionedHashTable(size_t cap = 8);
+        // VersionedHashTable function declarations
+        bool insert(const std::string& key, const size_t& value);
+        bool insert_or_assign(const std::string& key, const size_t& value);
+        bool remove(const std::string& key);
+        bool contains(const string& key) const;
+        optional<size_t> get(const string& key) const;
+        vector<std::string> keys() const;
+        double alpha() const;
+        size_t capacity() const;
+        size_t size() const;
+        VersionedHashTable snapshot() const;
+        HashTable toHashTable() const;
+        size_t sharedPages() const;
+        size_t locate(const std::string& key, size_t* firstEmpty = nullptr) const;
+        const HashTableBucket& bucket(size_t i) const;
+        HashTableBucket& writableBucket(size_t i);
+        size_t probe(size_t home, size_t i) const;
+        void resizeTable();
+        // Hasher declaration
+        std::hash<std::string> hasher;
+};